@@ -0,0 +1,156 @@
+#include "capture.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+#define CAPTURE_IO_BUFFER (1 << 20) //large stdio buffer, frames are written in big batches
+#define SAMPLES_PER_FRAME_MAX (SOUND_SAMPLE_RATE / 60 + 1)
+
+static FILE *open_output(const char *path) {
+    if (strcmp(path, "-") == 0) {
+#ifdef _WIN32
+        _setmode(_fileno(stdout), _O_BINARY);//no CRLF translation of frame data
+#endif
+        return stdout;
+    }
+    return fopen(path, "wb");
+}
+
+int capture_open(Capture *c, const char *video_path, const char *audio_path,
+                 CaptureFormat format, uint32_t scale, ColorTheme theme) {
+    memset(c, 0, sizeof(*c));
+    c->format = format;
+    c->scale = scale ? scale : 1;
+    display_palette_from_theme(theme, c->palette);
+
+    if (video_path) {
+        c->video = open_output(video_path);
+        if (!c->video) {
+            fprintf(stderr, "Failed to open video capture: %s\n", video_path);
+            return 1;
+        }
+        setvbuf(c->video, NULL, _IOFBF, CAPTURE_IO_BUFFER);
+        c->frame_size = (format == CAPTURE_PACKED)
+                      ? (SCREEN_WIDTH * SCREEN_HEIGHT) / 8
+                      : (size_t)SCREEN_WIDTH * c->scale * SCREEN_HEIGHT * c->scale * 3;
+        c->frame = malloc(c->frame_size);
+        if (!c->frame) {
+            capture_close(c);
+            return 1;
+        }
+    }
+
+    if (audio_path) {
+        c->audio = fopen(audio_path, "wb");
+        if (!c->audio) {
+            fprintf(stderr, "Failed to open audio capture: %s\n", audio_path);
+            capture_close(c);
+            return 1;
+        }
+        setvbuf(c->audio, NULL, _IOFBF, CAPTURE_IO_BUFFER);
+        sound_waves_init(&c->wave, &c->pattern, SOUND_SAMPLE_RATE);
+        c->samples = malloc(SAMPLES_PER_FRAME_MAX * sizeof(float));
+        c->pcm = malloc(SAMPLES_PER_FRAME_MAX * sizeof(int16_t));
+        if (!c->samples || !c->pcm) {
+            capture_close(c);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* 8 pixels per byte, pixel is ON if it is ON in any plane */
+static void encode_packed(const uint8_t *buffer, uint8_t *out) {
+    for (size_t i = 0; i < SCREEN_WIDTH * SCREEN_HEIGHT; i += 8) {
+        uint8_t byte = 0;
+        for (size_t b = 0; b < 8; b++)
+            byte = (uint8_t)((byte << 1) | (buffer[i + b] ? 1 : 0));
+        *out++ = byte;
+    }
+}
+
+/* Palette lookup + nearest neighbour scaling: build one output row per source row,
+   then repeat it scale times */
+static void encode_rgb(const Capture *c, const uint8_t *buffer, uint8_t *out) {
+    size_t row_bytes = (size_t)SCREEN_WIDTH * c->scale * 3;
+    for (size_t y = 0; y < SCREEN_HEIGHT; y++) {
+        uint8_t *row = out + y * c->scale * row_bytes;
+        uint8_t *p = row;
+        for (size_t x = 0; x < SCREEN_WIDTH; x++) {
+            uint32_t color = c->palette[buffer[idx(x, y)] & (PALETTE_SIZE - 1)];
+            for (uint32_t s = 0; s < c->scale; s++) {
+                *p++ = (uint8_t)(color >> 16);
+                *p++ = (uint8_t)(color >> 8);
+                *p++ = (uint8_t)color;
+            }
+        }
+        for (uint32_t s = 1; s < c->scale; s++)
+            memcpy(row + s * row_bytes, row, row_bytes);
+    }
+}
+
+static void write_audio(Capture *c, bool beep) {
+    //spread SOUND_SAMPLE_RATE samples evenly over 60 frames
+    int count = (int)(((c->frames + 1) * SOUND_SAMPLE_RATE) / 60 - (c->frames * SOUND_SAMPLE_RATE) / 60);
+
+    /* Same hold as the frame loop applies to the audio device, so the file sounds like the game */
+    bool on = beep || c->sound_delay > 0;
+    if (beep)
+        c->sound_delay = SOUND_HOLD_FRAMES;
+    if (c->sound_delay > 0)
+        c->sound_delay--;
+
+    if (on) {
+        sound_synthesize(&c->wave, &c->pattern, c->samples, count);
+        for (int i = 0; i < count; i++)
+            c->pcm[i] = (int16_t)(c->samples[i] * 32767.0f);
+    } else {
+        memset(c->pcm, 0, (size_t)count * sizeof(int16_t));//silence
+    }
+    fwrite(c->pcm, sizeof(int16_t), (size_t)count, c->audio);//host is little endian (x86/ARM)
+}
+
+void capture_frame(Capture *c, const uint8_t *buffer, bool changed, bool beep) {
+    if (c->video) {
+        if (changed || !c->have_frame) {//encode only frames that changed
+            if (c->format == CAPTURE_PACKED)
+                encode_packed(buffer, c->frame);
+            else
+                encode_rgb(c, buffer, c->frame);
+            c->have_frame = true;
+        }
+        fwrite(c->frame, 1, c->frame_size, c->video);//constant frame rate stream
+    }
+    if (c->audio)
+        write_audio(c, beep);
+    c->frames++;
+}
+
+void capture_set_pattern(Capture *c, const uint8_t pattern[16], uint8_t pitch) {
+    if (c->audio)
+        sound_pattern_load(&c->pattern, pattern, pitch, SOUND_SAMPLE_RATE);
+}
+
+void capture_close(Capture *c) {
+    if (c->video) {
+        if (c->video == stdout)
+            fflush(stdout);
+        else
+            fclose(c->video);
+        c->video = NULL;
+    }
+    if (c->audio) {
+        fclose(c->audio);
+        c->audio = NULL;
+    }
+    free(c->frame);
+    free(c->samples);
+    free(c->pcm);
+    c->frame = NULL;
+    c->samples = NULL;
+    c->pcm = NULL;
+}
@@ -0,0 +1,55 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "display.h"
+#include "sound.h"
+#include "vmemory.h"
+
+/* Raw video frame layouts written by --capture-video
+ *   CAPTURE_PACKED: 1 bit per pixel, MSB first, rows top to bottom, 256 bytes per frame
+ *   CAPTURE_RGB:    RGB24 scaled by 'scale', (64*scale) x (32*scale) x 3 bytes per frame
+ */
+typedef enum {
+    CAPTURE_PACKED,
+    CAPTURE_RGB
+} CaptureFormat;
+
+typedef struct {
+    FILE *video;
+    FILE *audio;//signed 16 bit little endian mono at SOUND_SAMPLE_RATE
+    CaptureFormat format;
+    uint32_t scale;
+    uint32_t palette[PALETTE_SIZE];
+
+    uint8_t *frame;//last encoded frame, written again as is while the screen doesn't change
+    size_t frame_size;
+    bool have_frame;
+
+    uint64_t frames;
+    int sound_delay;//beeper hold like the live audio (SOUND_HOLD_FRAMES)
+    SquareWave wave;
+    PatternWave pattern;
+    float *samples;
+    int16_t *pcm;
+} Capture;
+
+/* Open the outputs, either path may be NULL. "-" writes video to stdout.
+ * Returns 0 on success, non-zero on error (and prints an error message).
+ */
+int capture_open(Capture *c, const char *video_path, const char *audio_path,
+                 CaptureFormat format, uint32_t scale, ColorTheme theme);
+
+/* Append one emulated frame. 'changed' tells if the framebuffer changed since the last call,
+ * 'beep' if the sound timer was active during this frame.
+ */
+void capture_frame(Capture *c, const uint8_t *buffer, bool changed, bool beep);
+
+/* XO-CHIP program loaded a new audio pattern */
+void capture_set_pattern(Capture *c, const uint8_t pattern[16], uint8_t pitch);
+
+void capture_close(Capture *c);
+
+#endif /* CAPTURE_H */
@@ -3,6 +3,7 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
 
 #include "memory.h"
 #include "cpu.h"
@@ -13,37 +14,214 @@
 #include "display.h"
 #include "input.h"
 #include "sound.h"
+#include "debugger.h"
+#include "log.h"
+#include "metrics.h"
+#include "capture.h"
+#include "replay.h"
+#include "stream.h"
+#include "latency.h"
+#include "wall.h"
+#include "term.h"
+#include "chip8_core.h"
+#include "snapshot.h"
+#include "tribuf.h"
 
+#define FRAME_RATE 60ULL //timers, input and display all run at 60Hz
+#define MAX_LAG_FRAMES 6 //further behind than this (debugger, window drag) -> don't try to catch up
+#define LOG_DRAIN_MS 10 //the log thread writes queued lines this often
 
-int emulate_chip8(Config config) {
-    SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_TIMER);
+static uint64_t ticks_to_ns(uint64_t ticks, uint64_t freq) {
+    return ticks * 1000000000ULL / freq;//only used for short intervals, no overflow
+}
+
+/* CPU work allowed in frame number 'frame', in units of the timing model */
+static int64_t frame_budget(const Config *config, uint64_t frame) {
+    uint64_t cpu_clock = config->cpu_clock ? config->cpu_clock : DEFAULT_CPU_CLOCK;//600Hz 600 instructions per sec
+    return cpu_frame_budget(config->timing, cpu_clock, frame);
+}
+
+/* Returns true if the CPU went back in time (see debugger_step_back) */
+static bool handle_debugger_events(const InputEvent *ev, Cpu *cpu) {
+    if (ev->dbg_pause)
+        debugger_handle_event('o', cpu);
+    if (ev->dbg_resume)
+        debugger_handle_event('u', cpu);
+    if (ev->dbg_step)
+        debugger_handle_event('i', cpu);
+    if (ev->dbg_break)
+        debugger_handle_event('b', cpu);
+    if (ev->dbg_clear_break)
+        debugger_handle_event('n', cpu);
+    if (ev->dbg_step_back)
+        return debugger_step_back(cpu);
+    if (ev->dbg_reverse)
+        return debugger_reverse_continue(cpu);
+    return false;
+}
+
+/* Spend one frame budget on the CPU. Returns the cost actually spent.
+   'record': log for the time travel debugger (interactive runs only). */
+static int64_t run_cpu(Cpu *cpu, const uint8_t keypad[16], uint64_t frame, int64_t budget, bool record) {
+    int64_t spent = 0;
+
+    if (!dbg.paused && !dbg.step && dbg.breakpoint == 0) {
+        if (record)
+            debugger_record(cpu, frame, keypad_to_bits(keypad));
+        cpu_run_frame(cpu, keypad, frame, budget, &spent);//fast path, no per instruction debugger checks
+        return spent;
+    }
 
+    /* Debugger active: ask it before every single instruction */
+    while (spent < budget && debugger_should_execute(cpu)) {
+        int64_t one = 0;
+        if (record)
+            debugger_record(cpu, frame, keypad_to_bits(keypad));
+        cpu_run_frame(cpu, keypad, frame, 1, &one);//budget 1 -> exactly one instruction
+        if (one == 0)
+            break;//stalled on display wait
+        spent += one;
+    }
+    return spent;
+}
+
+/* The CPU is blocked on Fx0A: sleep until a key event or 'ms' passed. Returns true if woken by a key.
+   Other events are dropped like input_poll does, except quit which is put back. */
+static bool wait_key_event(uint32_t ms) {
+    uint32_t until = SDL_GetTicks() + ms;
+    SDL_Event e;
+
+    while (SDL_WaitEventTimeout(&e, (int)ms)) {
+        if (e.type == SDL_KEYDOWN || e.type == SDL_KEYUP)
+            return true;//keyboard state is already updated
+        if (e.type == SDL_QUIT) {
+            SDL_PushEvent(&e);
+            return true;
+        }
+        uint32_t now = SDL_GetTicks();
+        if (now >= until)
+            break;
+        ms = until - now;
+    }
+    return false;
+}
+
+/* Run-ahead: play the next frames with the current keypad, keep the screen they end with and
+   rewind. Returns true if those frames drew anything. */
+static bool run_ahead(Cpu *cpu, Snapshot *snap, const Config *config, uint64_t frame, int64_t credit,
+                      const uint8_t keypad[16], uint8_t *screen) {
+    snapshot_save(snap, cpu);
+    for (uint32_t k = 0; k < config->run_ahead; k++) {
+        int64_t spent = 0;
+        credit += frame_budget(config, frame + k);
+        cpu_run_frame(cpu, keypad, frame + k, credit, &spent);
+        credit -= spent;
+        if (credit > 0)
+            credit = 0;
+    }
+    bool drawn = cpu->vmemory.draw_flag;
+    memcpy(screen, cpu->vmemory.buffer, sizeof(cpu->vmemory.buffer));
+    snapshot_restore(snap, cpu);
+    return drawn;
+}
+
+/* Terminal output of log.h, so a slow or paused terminal never stalls the emulation */
+static SDL_atomic_t log_running;
+
+static int log_thread(void *data) {
+    (void)data;
+    while (SDL_AtomicGet(&log_running)) {
+        log_drain(stderr);
+        SDL_Delay(LOG_DRAIN_MS);
+    }
+    return 0;
+}
+
+/* State shared by the emulation thread and the SDL main thread with --threaded */
+typedef struct {
+    TripleBuffer frames;//finished frames, emulation -> render
+    SDL_atomic_t input;//input_to_bits of the latest poll, render -> emulation
+    SDL_atomic_t running;//cleared by the emulation thread when it returns
+    SDL_mutex *lock;//only for the Fx0A wait
+    SDL_cond *input_changed;
+} Frontend;
+
+/* --startup-trace: how long each startup step took, and when the first frame and audio came */
+typedef struct {
+    bool enabled;
+    uint64_t start;//emulate_chip8 entered
+    uint64_t last;//previous step ended
+    bool first_frame;//already reported
+    bool audio;
+} StartupTrace;
+
+typedef struct {
+    Config config;
+    StartupTrace trace;
     DisplayHandler display;
     InputHandler input;
     SoundHandler sound;
+    Metrics metrics;
+    Capture capture;
+    Snapshot ahead;
+    uint8_t ahead_screen[SCREEN_WIDTH * SCREEN_HEIGHT];
+    Replay replay;
+    Stream stream;
+    LatencyProbe latency;
+    uint8_t *program;
+    long rom_size;
+    Frontend *frontend;//NULL: emulation, input and rendering all on the calling thread
+} Emulator;
 
-    display_init(&display, config.scale, config.theme);
-    input_init(&input);//do nothing
-    sound_create(&sound, config.muted);
+static double trace_ms(uint64_t ticks) {
+    return (double)ticks * 1000.0 / (double)SDL_GetPerformanceFrequency();
+}
 
-    FILE* rom = fopen(config.program_filename, "rb");
-    if(!rom) {
-        fprintf(stderr, "Failed to open ROM: %s\n", config.program_filename);
-        return 1;
-    }
-    //Get ROM data
-    fseek(rom, 0, SEEK_END);
-    long rom_size = ftell(rom);
-    fseek(rom, 0, SEEK_SET);
-    uint8_t* program = malloc(rom_size);
-    fread(program, 1, rom_size, rom);
-    fclose(rom);
+/* One sequential startup step */
+static void trace_step(StartupTrace *t, const char *step) {
+    if (!t->enabled)
+        return;
+    uint64_t now = SDL_GetPerformanceCounter();
+    fprintf(stderr, "[startup] %-12s %8.2fms  (at %8.2fms)\n", step, trace_ms(now - t->last), trace_ms(now - t->start));
+    t->last = now;
+}
+
+/* An event reported once, from whichever thread sees it first */
+static void trace_once(StartupTrace *t, bool *reported, const char *event) {
+    if (!t->enabled || *reported)
+        return;
+    *reported = true;
+    fprintf(stderr, "[startup] %-12s            (at %8.2fms)\n", event, trace_ms(SDL_GetPerformanceCounter() - t->start));
+}
+
+/* Threaded: the CPU is blocked on Fx0A, sleep until the render thread sees new input or 'ms' passed */
+static void wait_input_change(Frontend *f, uint32_t seen, uint32_t ms) {
+    SDL_LockMutex(f->lock);
+    if ((uint32_t)SDL_AtomicGet(&f->input) == seen)
+        SDL_CondWaitTimeout(f->input_changed, f->lock, ms);
+    SDL_UnlockMutex(f->lock);
+}
+
+/* Threaded: hand the finished frame to the render thread, never blocks */
+static void publish_frame(Frontend *f, const uint8_t *pixels, const Metrics *metrics, uint64_t frame) {
+    FrameSlot *slot = tribuf_back(&f->frames);
+    memcpy(slot->pixels, pixels, sizeof(slot->pixels));
+    slot->last = metrics->last;
+    slot->frame = frame;
+    tribuf_publish(&f->frames);
+}
+
+static int emulation_loop(Emulator *e) {
+    const Config config = e->config;
+    Frontend *frontend = e->frontend;
+    InputEvent ev;
+    uint32_t input_bits = 0;
+    memset(&ev, 0, sizeof(ev));//headless never polls, keypad stays released
 
     int running = 1;
 
-    const uint64_t cycle_duration_timer_ns = 1000000000ULL / 60ULL;//1sec/60 = 16.67msec or 16,666,666nsec
-    uint64_t cpu_clock = config.cpu_clock ? config.cpu_clock : DEFAULT_CPU_CLOCK;//600Hz 600 instructions per sec
-    const uint64_t cycle_duration_cpu_ns = 1000000000ULL / cpu_clock;//16,666,666nsec, desired time per CPU instruction
+    const uint64_t freq = SDL_GetPerformanceFrequency();
+    const bool redraw_always = e->metrics.overlay || display_animating(&e->display);//both change every frame
 
     while(running) {
         //chip8 has following components:
@@ -56,94 +234,484 @@ int emulate_chip8(Config config) {
         VMemory vmemory;
         Cpu cpu;
 
-        memory_new(&mem, program, rom_size);
+        if (memory_new(&mem, e->program, (size_t)e->rom_size) != 0) {//the size was checked, so out of memory
+            fprintf(stderr, "Failed to allocate the CHIP-8 RAM\n");
+            return 1;
+        }
         timer_init(&timer);
         vmemory_init(&vmemory);
         cpu_new(&cpu, &mem, &timer, &vmemory);
+        cpu_set_profile(&cpu, config.profile);
+        cpu_set_timing(&cpu, config.timing);
         debugger_init();
+        replay_rewind(&e->replay);
 
         int sound_delay = 0;
+        uint64_t frame = 0;
+        int64_t credit = 0;//CPU budget carried between frames (negative after an overshoot)
+        uint64_t start = SDL_GetPerformanceCounter();
 
+        /* One iteration per host frame: input, then 'batch' emulated frames (timers, CPU budget),
+           display only the last one, then sleep once */
+        uint64_t host_frame = 0;
         while(1) {
-            //uint32_t start_ticks = SDL_GetTicks();
-            bool beep = cpu_update_timers(&cpu);
-            uint64_t t0 = SDL_GetPerformanceCounter();
-            uint64_t freq = SDL_GetPerformanceFrequency();
-
-            uint64_t elapsed_ns = 0;
-
-            if(beep) {
-                sound_delay = 3;//keep beep ON for 3 ticks
-                sound_resume(&sound);
-            } else if(sound_delay == 0) {
-                sound_pause(&sound);
+            FrameSample sample = {0};
+            uint64_t t_input = SDL_GetPerformanceCounter();
+            if (frontend) {
+                input_bits = (uint32_t)SDL_AtomicGet(&frontend->input);
+                input_from_bits(input_bits, &ev);
+            } else if (!config.headless) {
+                input_poll(&e->input, &ev);
+                latency_input(&e->latency, &e->input);
             }
-            if(sound_delay > 0) 
-                sound_delay--;
+            uint64_t t_cpu = SDL_GetPerformanceCounter();
+            sample.values[METRIC_INPUT] = ticks_to_ns(t_cpu - t_input, freq);
 
-            while(1) {
-                input_poll(&input, &input.ev);
+            if(ev.quit) {
+                running = 0;
+                break;
+            }
+            if(ev.restart)
+                break;
+
+            /* Debugger control. After a step back the frame number follows the CPU, recordings,
+               input scripts and streams keep going forward. */
+            if (handle_debugger_events(&ev, &cpu)) {
+                frame = cpu.timer.frame;
+                credit = 0;
+            }
 
-                if(input.ev.quit) {
+            /* Fast-forward while the turbo key is held: render and audio only follow the last frame */
+            uint32_t batch = ev.turbo ? config.turbo : 1;
+            bool beep = false;
+            bool changed = false;
+            uint64_t instructions = cpu.instructions;
+
+            for (uint32_t n = 0; n < batch; n++) {
+                if (config.max_frames && frame >= config.max_frames) {
                     running = 0;
                     break;
                 }
-                if(input.ev.restart)
-                    break;
+                beep = timer_sound_on(&cpu.timer, frame);//lazy timers, nothing to update per frame
 
-                /* Debugger control */
-                if (input.ev.dbg_pause)  
-                    debugger_handle_event('o', &cpu);
-                if (input.ev.dbg_resume) 
-                    debugger_handle_event('u', &cpu);
-                if (input.ev.dbg_step) {
-                    debugger_handle_event('i', &cpu);
-                }
-                if (input.ev.dbg_break) {
-                    debugger_handle_event('b', &cpu);
-                }
-                if (input.ev.dbg_clear_break) {
-                    debugger_handle_event('n', &cpu);
+                if(cpu.audio_dirty) {//XO-CHIP program changed its audio pattern
+                    cpu.audio_dirty = false;
+                    if (!config.headless)
+                        sound_set_pattern(&e->sound, cpu.audio_pattern, cpu.audio_pitch);
+                    capture_set_pattern(&e->capture, cpu.audio_pattern, cpu.audio_pitch);
                 }
 
-                if (debugger_should_execute(&cpu)) {
-                    cpu_cycle(&cpu, input.ev.keypad, &display);
-                }
-                if(display.draw_pixels!=NULL) {
-                    display_draw(&display);
+                uint16_t remote;
+                if (e->replay.events)//scripted input replaces the keyboard
+                    keypad_from_bits(replay_keys(&e->replay, frame), ev.keypad);
+                else if (stream_keys(&e->stream, &remote))//so does a stream viewer that sends keys
+                    keypad_from_bits(remote, ev.keypad);
+                replay_record(&e->replay, frame, keypad_to_bits(ev.keypad));
+
+                credit += frame_budget(&config, frame);
+                credit -= run_cpu(&cpu, ev.keypad, frame, credit, !config.headless);
+                if (credit > 0)
+                    credit = 0;//CPU stalled (display wait, debugger), the unused time is lost
+
+                latency_frame(&e->latency, &cpu);
+                bool frame_changed = cpu.vmemory.draw_flag;
+                cpu.vmemory.draw_flag = false;
+                changed |= frame_changed;
+                capture_frame(&e->capture, cpu.vmemory.buffer, frame_changed, beep);//the capture keeps every frame
+                stream_frame(&e->stream, &cpu.vmemory, frame);
+                frame++;
+            }
+            if (!running)
+                break;
+
+            uint64_t t_display = SDL_GetPerformanceCounter();
+            sample.values[METRIC_INSTRUCTIONS] = cpu.instructions - instructions;
+            sample.idle = cpu.idle || cpu.key_wait;
+            sample.values[METRIC_CPU] = ticks_to_ns(t_display - t_cpu, freq);
+
+            if (!config.headless) {
+                if(beep) {
+                    sound_delay = SOUND_HOLD_FRAMES;//keep beep ON for 3 ticks (capture.c does the same)
+                    sound_resume(&e->sound);
+                } else if(sound_delay == 0) {
+                    sound_pause(&e->sound);
                 }
+                if(sound_delay > 0) 
+                    sound_delay--;
+            }
 
-                /* CPU timing: measure time for the cycle and sleep if needed */
-                uint64_t t1 = SDL_GetPerformanceCounter();
-                //convert to nsec
-                uint64_t cycle_time_ns = (uint64_t)((t1 - t0) * 1000000000ULL / freq) - elapsed_ns;
-                elapsed_ns += cycle_time_ns;//accumulate elapsed time
-
-                /*//check cpu running too fast (>600 instructions per sec) speed control*/
-                if (cycle_time_ns < cycle_duration_cpu_ns) {
-                    /* If instruction executed faster than that, we must slow down. */
-                    /*calculate how long to sleep*/
-                    uint64_t sleep_ns = cycle_duration_cpu_ns - cycle_time_ns;
-                    /*convert ns to ms Formulat with roundup: x+(1000000-1)/1000000*/
-                    uint32_t sleep_ms = (uint32_t)((sleep_ns + 999999ULL) / 1000000ULL);
-                    if (sleep_ms > 0) 
-                        SDL_Delay(sleep_ms);
-                    elapsed_ns += sleep_ms * 1000000ULL;
+            uint8_t *draw_pixels = cpu.vmemory.buffer;
+            if (config.run_ahead && !config.headless && !dbg.paused && !dbg.step) {
+                /* Show the future, the real machine state is untouched */
+                changed |= run_ahead(&cpu, &e->ahead, &config, frame, credit, ev.keypad, e->ahead_screen);
+                draw_pixels = e->ahead_screen;
+            }
+
+            if (frontend) {
+                if (changed || redraw_always)
+                    publish_frame(frontend, draw_pixels, &e->metrics, frame);
+            } else if(!config.headless && (changed || redraw_always || dbg.paused)) {
+                e->display.draw_pixels = draw_pixels;
+                if (display_render(&e->display) == 0) {
+                    metrics_render_overlay(&e->metrics, e->display.renderer);
+                    debugger_render(e->display.renderer, &cpu);
+                    display_present(&e->display);
+                    latency_present(&e->latency);
                 }
+            }
+            if (!frontend)
+                trace_once(&e->trace, &e->trace.first_frame, "first frame");
+            if (e->sound.device)
+                trace_once(&e->trace, &e->trace.audio, "audio open");//first beep
+            host_frame++;
 
-                /* Break out of CPU loop if we reached timer tick */
-                if (elapsed_ns >= cycle_duration_timer_ns) {
-                    /*decrement delay timer, sound timer, screen refresh every ~16.7msec*/
-                    break;
+            if (config.headless) {//batch mode runs as fast as possible
+                sample.values[METRIC_DISPLAY] = ticks_to_ns(SDL_GetPerformanceCounter() - t_display, freq);
+                metrics_record(&e->metrics, &sample);
+                continue;
+            }
+
+            /* Frame pacing: sleep once per frame until the next 60Hz deadline (~16.7msec) */
+            uint64_t deadline = start + host_frame * freq / FRAME_RATE;
+            uint64_t now = SDL_GetPerformanceCounter();
+            sample.values[METRIC_DISPLAY] = ticks_to_ns(now - t_display, freq);
+            if (now < deadline) {
+                uint32_t sleep_ms = (uint32_t)((deadline - now) * 1000ULL / freq);//round down, never oversleep
+                if (cpu.key_wait && deadline - now <= freq / FRAME_RATE) {
+                    /* Waiting for a key: a key event starts the next frame early (at most one frame
+                       ahead, the deadlines stay absolute) */
+                    if (frontend)
+                        wait_input_change(frontend, input_bits, sleep_ms);
+                    else
+                        wait_key_event(sleep_ms);
+                    sample.values[METRIC_SLEEP] = ticks_to_ns(SDL_GetPerformanceCounter() - now, freq);
+                } else if (sleep_ms > 0) {
+                    SDL_Delay(sleep_ms);
+                    uint64_t slept = ticks_to_ns(SDL_GetPerformanceCounter() - now, freq);
+                    sample.values[METRIC_SLEEP] = slept;
+                    if (slept > sleep_ms * 1000000ULL)
+                        sample.values[METRIC_OVERSHOOT] = slept - sleep_ms * 1000000ULL;
                 }
+            } else {
+                sample.missed = true;
+                if (now - deadline > MAX_LAG_FRAMES * freq / FRAME_RATE)
+                    start = now - host_frame * freq / FRAME_RATE;//resync instead of running a burst of frames
             }
-            if (!running){
-                break;
+            metrics_record(&e->metrics, &sample);
+        }
+        memory_free(&mem);
+    }
+    return 0;
+}
+
+static int emulation_thread(void *data) {
+    Emulator *e = data;
+    int rc = emulation_loop(e);
+    SDL_AtomicSet(&e->frontend->running, 0);
+    return rc;
+}
+
+/* SDL main thread with --threaded: pump events, publish the input and show the newest frame.
+   A slow present (vsync, compositor) only delays the picture, never the emulation thread. */
+static void render_loop(Emulator *e, bool overlay) {
+    Frontend *f = e->frontend;
+    uint32_t sent = 0;
+    int quit = 0;
+    Metrics view;
+    memset(&view, 0, sizeof(view));
+    view.overlay = overlay;
+
+    while (SDL_AtomicGet(&f->running)) {
+        input_poll(&e->input, &e->input.ev);
+        quit |= e->input.ev.quit;//SDL_QUIT is a single event, keep it until the emulation thread is gone
+        e->input.ev.quit = quit;
+        uint32_t bits = input_to_bits(&e->input.ev);
+        if (bits != sent) {
+            SDL_LockMutex(f->lock);
+            SDL_AtomicSet(&f->input, (int)bits);
+            SDL_CondSignal(f->input_changed);
+            SDL_UnlockMutex(f->lock);
+            sent = bits;
+        }
+
+        FrameSlot *slot = tribuf_take(&f->frames);
+        if (!slot) {
+            SDL_WaitEventTimeout(NULL, 1);//next event or 1msec, whichever comes first
+            continue;
+        }
+        e->display.draw_pixels = slot->pixels;
+        if (display_render(&e->display) == 0) {
+            view.last = slot->last;
+            metrics_render_overlay(&view, e->display.renderer);
+            display_present(&e->display);
+            trace_once(&e->trace, &e->trace.first_frame, "first frame");
+        }
+    }
+}
+
+int emulate_chip8(Config config) {
+    static Emulator emu;//big, and shared with the emulation thread
+    Emulator *e = &emu;
+    memset(e, 0, sizeof(*e));
+    e->config = config;
+    int rc = 1;
+    SDL_Thread *logger = NULL;
+    e->trace.enabled = config.startup_trace;
+    e->trace.start = e->trace.last = SDL_GetPerformanceCounter();
+
+    /* The ROM first, so a bad one fails before any window, device or thread exists */
+    size_t rom_size = 0;
+    e->program = memory_read_rom(config.program_filename, &rom_size);
+    if (!e->program) {
+        fprintf(stderr, "Failed to read ROM: %s\n", config.program_filename);
+        return 1;
+    }
+    if (rom_size > PROGRAM_MAX_SIZE) {
+        fprintf(stderr, "ROM too large: %zu bytes, at most %d fit after 0x%X\n", rom_size, PROGRAM_MAX_SIZE, PROGRAM_START);
+        free(e->program);
+        e->program = NULL;
+        return 1;
+    }
+    e->rom_size = (long)rom_size;
+
+    /* Subsystems start when first needed: video in display_init, audio on the first beep
+       (never when muted). Headless: no window, no audio device, no input, no frame pacing */
+    SDL_Init(SDL_INIT_TIMER);
+    trace_step(&e->trace, "sdl init");
+
+    if (!config.headless) {
+        if (display_init(&e->display, config.scale, config.theme) == 0)
+            display_set_effects(&e->display, config.phosphor, config.crt);
+        trace_step(&e->trace, "display");
+        sound_create(&e->sound, config.muted);
+    }
+    input_init(&e->input);//do nothing
+    memset(&e->input.ev, 0, sizeof(e->input.ev));
+
+    e->stream.fd = e->stream.in_fd = -1;//closed until stream_open, cleanup may run before it
+
+    /* Every failure from here on goes through cleanup, which copes with whatever isn't open yet */
+    if (metrics_init(&e->metrics, config.stats, config.stats_file, config.stats_overlay && !config.headless) != 0)
+        goto cleanup;
+
+    if (capture_open(&e->capture, config.capture_video, config.capture_audio,
+                     config.capture_format, config.scale, config.theme) != 0)
+        goto cleanup;
+
+    if (config.run_ahead && snapshot_init(&e->ahead) != 0)
+        goto cleanup;
+
+    if (replay_open(&e->replay, config.input_script, config.record_input) != 0)
+        goto cleanup;
+
+    if (stream_open(&e->stream, config.stream) != 0)
+        goto cleanup;
+
+    latency_init(&e->latency, config.latency && !config.headless && !config.threaded);
+
+    trace_step(&e->trace, "setup");
+
+    log_set_async(true);//resets the ring, so before the consumer starts reading it
+    SDL_AtomicSet(&log_running, 1);
+    logger = SDL_CreateThread(log_thread, "log", NULL);
+    if (!logger)
+        log_set_async(false);//lines are written synchronously
+
+    static Frontend frontend;
+    SDL_Thread *thread = NULL;
+    if (config.threaded && !config.headless) {
+        tribuf_init(&frontend.frames);
+        SDL_AtomicSet(&frontend.input, 0);
+        SDL_AtomicSet(&frontend.running, 1);
+        frontend.lock = SDL_CreateMutex();
+        frontend.input_changed = SDL_CreateCond();
+        e->frontend = &frontend;
+        if (frontend.lock && frontend.input_changed)
+            thread = SDL_CreateThread(emulation_thread, "emulation", e);
+        if (!thread) {
+            fprintf(stderr, "Failed to start the emulation thread, running single threaded: %s\n", SDL_GetError());
+            e->frontend = NULL;
+        }
+    }
+
+    if (thread) {
+        render_loop(e, e->metrics.overlay);
+        SDL_WaitThread(thread, &rc);
+    } else {
+        rc = emulation_loop(e);
+    }
+    if (frontend.input_changed)
+        SDL_DestroyCond(frontend.input_changed);
+    if (frontend.lock)
+        SDL_DestroyMutex(frontend.lock);
+
+cleanup:
+    free(e->program);
+    capture_close(&e->capture);
+    replay_close(&e->replay);
+    stream_close(&e->stream);
+    snapshot_free(&e->ahead);
+    metrics_shutdown(&e->metrics);
+    latency_report(&e->latency);
+    debugger_free();
+    if (logger) {
+        SDL_AtomicSet(&log_running, 0);
+        SDL_WaitThread(logger, NULL);
+        log_set_async(false);//writes what is left
+    }
+    if (!config.headless) {
+        sound_close(&e->sound);
+        display_shutdown(&e->display);
+    }
+    SDL_Quit();
+    return rc;
+}
+
+/* Sleep until host frame 'host_frame' is due, like the single window without the key wait shortcut */
+static void pace_frame(uint64_t *start, uint64_t host_frame, uint64_t freq) {
+    uint64_t deadline = *start + host_frame * freq / FRAME_RATE;
+    uint64_t now = SDL_GetPerformanceCounter();
+    if (now < deadline) {
+        uint32_t sleep_ms = (uint32_t)((deadline - now) * 1000ULL / freq);
+        if (sleep_ms > 0)
+            SDL_Delay(sleep_ms);
+    } else if (now - deadline > MAX_LAG_FRAMES * freq / FRAME_RATE) {
+        *start = now - host_frame * freq / FRAME_RATE;
+    }
+}
+
+/* --wall: 'config.wall' instances of the ROM in one window, each a chip8_core machine with its own
+   random seed. The keyboard goes to every instance, restart resets them all. No sound. */
+int emulate_wall(Config config) {
+    size_t got = 0;
+    uint8_t *program = memory_read_rom(config.program_filename, &got);
+    if (!program) {
+        fprintf(stderr, "Failed to read ROM: %s\n", config.program_filename);
+        return 1;
+    }
+
+    Chip8 **inst = calloc(config.wall, sizeof(*inst));
+    bool *stopped = calloc(config.wall, sizeof(*stopped));//an instruction failed, the tile keeps its last frame
+    if (!inst || !stopped) {
+        fprintf(stderr, "Wall: out of memory\n");
+        free(program);
+        free(inst);
+        free(stopped);
+        return 1;
+    }
+    Chip8Options options = {config.profile, config.timing, config.cpu_clock, 0};
+    int rc = 0;
+    for (uint32_t i = 0; i < config.wall && rc == 0; i++) {
+        options.seed = 0x2545F491u + i * 0x9E3779B9u;//instance 0 matches the single window
+        inst[i] = chip8_create(program, got, &options);
+        if (!inst[i]) {
+            fprintf(stderr, "Wall: can't create instance %u\n", (unsigned)i);
+            rc = 1;
+        }
+    }
+    free(program);
+
+    SDL_Init(SDL_INIT_TIMER);
+    static Wall wall;
+    InputHandler input;
+    InputEvent ev;
+    input_init(&input);
+    memset(&ev, 0, sizeof(ev));
+    if (rc == 0 && wall_init(&wall, config.wall, config.scale, config.theme) != 0)
+        rc = 1;
+
+    const uint64_t freq = SDL_GetPerformanceFrequency();
+    uint64_t start = SDL_GetPerformanceCounter();
+    uint64_t host_frame = 0;
+    uint64_t frame = 0;
+    while (rc == 0) {
+        input_poll(&input, &ev);
+        if (ev.quit)
+            break;
+        if (ev.restart) {
+            for (uint32_t i = 0; i < config.wall; i++) {
+                chip8_reset(inst[i]);
+                stopped[i] = false;
             }
         }
+
+        uint32_t batch = ev.turbo ? config.turbo : 1;
+        if (config.max_frames && frame + batch > config.max_frames)
+            batch = (uint32_t)(config.max_frames - frame);
+        if (batch == 0)
+            break;
+        uint16_t keys = keypad_to_bits(ev.keypad);
+        for (uint32_t i = 0; i < config.wall; i++) {
+            if (stopped[i])
+                continue;
+            if (chip8_step_frames(inst[i], batch, keys) != 0)
+                stopped[i] = true;
+            if (chip8_frame_changed(inst[i]))
+                wall_update(&wall, i, chip8_framebuffer(inst[i]));
+        }
+        frame += batch;
+        wall_present(&wall);
+        host_frame++;
+        pace_frame(&start, host_frame, freq);
     }
+
+    for (uint32_t i = 0; i < config.wall; i++)
+        chip8_destroy(inst[i]);
+    free(inst);
+    free(stopped);
+    wall_shutdown(&wall);
+    SDL_Quit();
+    return rc;
+}
+
+/* --term: one core machine drawn into the terminal (term.h), no window and no sound */
+int emulate_term(Config config) {
+    size_t got = 0;
+    uint8_t *program = memory_read_rom(config.program_filename, &got);
+    if (!program) {
+        fprintf(stderr, "Failed to read ROM: %s\n", config.program_filename);
+        return 1;
+    }
+    Chip8Options options = {config.profile, config.timing, config.cpu_clock, 0};
+    Chip8 *inst = chip8_create(program, got, &options);
     free(program);
-    display_shutdown(&display);
+    if (!inst) {
+        fprintf(stderr, "Term: can't create the machine\n");
+        return 1;
+    }
+
+    SDL_Init(SDL_INIT_TIMER);
+    static Terminal term;
+    InputEvent ev;
+    int rc = term_init(&term, config.theme);
+    bool stopped = false;//an instruction failed, the picture keeps its last frame
+
+    const uint64_t freq = SDL_GetPerformanceFrequency();
+    uint64_t start = SDL_GetPerformanceCounter();
+    uint64_t host_frame = 0;
+    uint64_t frame = 0;
+    while (rc == 0) {
+        term_poll(&term, &ev);
+        if (ev.quit)
+            break;
+        if (ev.restart) {
+            chip8_reset(inst);
+            stopped = false;
+        }
+
+        if (config.max_frames && frame >= config.max_frames)
+            break;
+        if (!stopped && chip8_step_frames(inst, 1, keypad_to_bits(ev.keypad)) != 0)
+            stopped = true;
+        frame++;
+        if (term_draw(&term, chip8_framebuffer(inst)) != 0)
+            rc = 1;//terminal gone
+        host_frame++;
+        pace_frame(&start, host_frame, freq);
+    }
+
+    term_shutdown(&term);
+    chip8_destroy(inst);
     SDL_Quit();
-    return 0;
+    return rc;
 }
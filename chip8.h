@@ -5,6 +5,8 @@
 #include <stddef.h>
 #include <stdbool.h>
 #include "display.h" // For ColorTheme
+#include "cpu.h" // For QuirkProfile
+#include "capture.h" // For CaptureFormat
 
 typedef struct {
     const char* program_filename;//input ROM file
@@ -12,9 +14,42 @@ typedef struct {
     uint32_t scale;
     uint64_t cpu_clock;
     bool muted;
+    QuirkProfile profile;
+    TimingModel timing;
+    bool stats;//periodic frame pacing line on stderr
+    const char *stats_file;//per frame CSV, NULL if not wanted
+    bool stats_overlay;//timing bars drawn over the game
+    bool headless;//no window/audio/input, run unthrottled
+    uint64_t max_frames;//stop after this many frames, 0 = run until quit
+    const char *capture_video;//raw frame stream path or "-" for stdout, NULL if not wanted
+    const char *capture_audio;//raw S16LE mono path, NULL if not wanted
+    CaptureFormat capture_format;
+    const char *input_script;//keypad playback file, NULL = keyboard
+    const char *record_input;//keypad recording file, NULL if not wanted
+    uint32_t turbo;//emulated frames per host frame while fast-forwarding
+    uint32_t run_ahead;//frames emulated ahead of the shown one, 0 = off
+    const char *stream;//screen delta stream target (- or unix:<path>), NULL if not wanted
+    uint32_t phosphor;//percent of the old picture kept per frame, 0 = off
+    bool crt;//CPU scaled picture with aperture grille and scanlines
+    bool startup_trace;//print how long startup took up to the first frame
+    bool threaded;//emulation on its own thread, the main thread only renders and polls input
+    bool latency;//measure keypad event to screen time, single threaded only
+    uint32_t wall;//instances tiled in one window (emulate_wall), 0 = normal single instance
+    bool term;//draw into the terminal instead of a window (emulate_term)
+    bool validate;//run the fast and the reference CPU engine side by side instead of playing (validate.h)
 } Config;
 
 int emulate_chip8(Config config);
+/* Many instances of the ROM in one window through a texture atlas (wall.h) */
+int emulate_wall(Config config);
+/* The ROM in the terminal, Unicode half blocks and keys from stdin (term.h) */
+int emulate_term(Config config);
 
 #define DEFAULT_CPU_CLOCK 600
+#define MIN_CPU_CLOCK 1
+#define MAX_CPU_CLOCK 1000000 //instructions per second, 1MHz is already far beyond any real machine
+#define DEFAULT_TURBO 4
+#define MAX_TURBO 64
+#define MAX_RUN_AHEAD 8
+#define MAX_WALL 1024
 #endif // CONFIG_H
\ No newline at end of file
@@ -0,0 +1,126 @@
+#include "chip8_core.h"
+#include <stdlib.h>
+#include <string.h>
+
+#include "memory.h"
+#include "timer.h"
+
+struct Chip8 {
+    Cpu cpu;
+    Chip8Options options;
+    uint8_t *program;
+    size_t program_len;
+    uint64_t frame;//next frame to run
+    int64_t credit;//CPU budget carried between frames (negative after an overshoot)
+    bool changed;
+};
+
+static int chip8_power_on(Chip8 *inst) {
+    Memory mem;
+    Timer timer;
+    VMemory vmemory;
+
+    if (memory_new(&mem, inst->program, inst->program_len) != 0)
+        return 1;
+    timer_init(&timer);
+    vmemory_init(&vmemory);
+    cpu_new(&inst->cpu, &mem, &timer, &vmemory);
+    cpu_set_profile(&inst->cpu, inst->options.profile);
+    cpu_set_timing(&inst->cpu, inst->options.timing);
+    if (inst->options.seed)
+        inst->cpu.rng = inst->options.seed;
+    inst->frame = 0;
+    inst->credit = 0;
+    inst->changed = false;
+    return 0;
+}
+
+Chip8 *chip8_create(const uint8_t *program, size_t program_len, const Chip8Options *options) {
+    Chip8 *inst = calloc(1, sizeof(*inst));
+    if (!inst)
+        return NULL;
+
+    if (options) {
+        inst->options = *options;
+    } else {
+        inst->options.profile = DEFAULT_QUIRK_PROFILE;
+        inst->options.timing = TIMING_INSTRUCTIONS;
+    }
+    if (inst->options.cpu_clock == 0)
+        inst->options.cpu_clock = DEFAULT_CORE_CLOCK;
+
+    inst->program = malloc(program_len ? program_len : 1);
+    inst->program_len = program_len;
+    if (!inst->program) {
+        free(inst);
+        return NULL;
+    }
+    if (program_len)
+        memcpy(inst->program, program, program_len);
+
+    if (chip8_power_on(inst) != 0) {
+        free(inst->program);
+        free(inst);
+        return NULL;
+    }
+    return inst;
+}
+
+void chip8_destroy(Chip8 *inst) {
+    if (!inst)
+        return;
+    memory_free(&inst->cpu.memory);
+    free(inst->program);
+    free(inst);
+}
+
+int chip8_reset(Chip8 *inst) {
+    Memory old = inst->cpu.memory;
+    if (chip8_power_on(inst) != 0)
+        return 1;//nothing was touched, the machine keeps its state
+    memory_free(&old);
+    return 0;
+}
+
+int chip8_step_frames(Chip8 *inst, uint32_t n, uint16_t keypad_bits) {
+    Cpu *cpu = &inst->cpu;
+    uint8_t keypad[16];
+    keypad_from_bits(keypad_bits, keypad);
+    inst->changed = false;
+
+    /* Same scheduler as the frontend's frame loop, minus everything that talks to the host */
+    for (uint32_t k = 0; k < n; k++) {
+        int64_t spent = 0;
+        inst->credit += cpu_frame_budget(inst->options.timing, inst->options.cpu_clock, inst->frame);
+        int rc = cpu_run_frame(cpu, keypad, inst->frame, inst->credit, &spent);
+        inst->credit -= spent;
+        if (inst->credit > 0)
+            inst->credit = 0;//CPU stalled (display or key wait), the unused time is lost
+        inst->changed |= cpu->vmemory.draw_flag;
+        cpu->vmemory.draw_flag = false;
+        inst->frame++;
+        if (rc != 0)
+            return rc;
+    }
+    return 0;
+}
+
+const uint8_t *chip8_framebuffer(const Chip8 *inst) {
+    return inst->cpu.vmemory.buffer;
+}
+
+const uint8_t *chip8_memory(const Chip8 *inst) {
+    return inst->cpu.memory.mem;
+}
+
+bool chip8_frame_changed(const Chip8 *inst) {
+    return inst->changed;
+}
+
+bool chip8_sound_on(const Chip8 *inst) {
+    return inst->frame > 0 && timer_sound_on(&inst->cpu.timer, inst->frame - 1);
+}
+
+uint64_t chip8_frame_count(const Chip8 *inst) {
+    return inst->frame;
+}
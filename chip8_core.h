@@ -0,0 +1,59 @@
+#ifndef CHIP8_CORE_H
+#define CHIP8_CORE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "cpu.h" // For QuirkProfile, TimingModel
+#include "vmemory.h" // For SCREEN_WIDTH, SCREEN_HEIGHT
+
+/*
+ * Embeddable emulator core (libchip8), no SDL needed: cpu.c, memory.c, vmemory.c, timer.c
+ * and chip8_core.c. One instance is one machine, instances share nothing.
+ * The caller drives it in whole 60Hz frames, every frame runs in the same scheduler as the
+ * SDL frontend (timers, CPU budget and overshoot carry), so results are identical to it.
+ */
+typedef struct Chip8 Chip8;
+
+typedef struct {
+    QuirkProfile profile;
+    TimingModel timing;
+    uint64_t cpu_clock;//instructions per second with TIMING_INSTRUCTIONS, 0 = DEFAULT_CORE_CLOCK
+    uint32_t seed;//Cxkk random generator seed, 0 = the fixed seed of the SDL frontend
+} Chip8Options;
+
+#define DEFAULT_CORE_CLOCK 600
+
+/* Load 'program' (copied) at 0x200. 'options' may be NULL for the defaults (legacy quirks, 600Hz).
+ * Returns NULL if out of memory or the program doesn't fit.
+ */
+Chip8 *chip8_create(const uint8_t *program, size_t program_len, const Chip8Options *options);
+void chip8_destroy(Chip8 *inst);
+
+/* Back to power on with the same program and options. Returns 0 on success, 1 if out of memory,
+   in which case the machine is left as it was */
+int chip8_reset(Chip8 *inst);
+
+/* Run 'n' frames with the keypad held as 'keypad_bits' (bit k = key k pressed).
+ * Returns 0 on success, non-zero if an instruction failed (the frame it failed in is complete).
+ */
+int chip8_step_frames(Chip8 *inst, uint32_t n, uint16_t keypad_bits);
+
+/* SCREEN_WIDTH * SCREEN_HEIGHT bytes, one per pixel (bitmask of the XO-CHIP planes that are on).
+ * Points into the instance, stays valid until chip8_destroy and always shows the last frame.
+ */
+const uint8_t *chip8_framebuffer(const Chip8 *inst);
+
+/* The MEMORY_SIZE bytes of RAM, read-only (scores, lives, game state). Valid until chip8_reset. */
+const uint8_t *chip8_memory(const Chip8 *inst);
+
+/* True if the last chip8_step_frames drew anything */
+bool chip8_frame_changed(const Chip8 *inst);
+
+/* True if the beeper sounds during the last stepped frame */
+bool chip8_sound_on(const Chip8 *inst);
+
+/* Frames stepped since create or reset */
+uint64_t chip8_frame_count(const Chip8 *inst);
+
+#endif /* CHIP8_CORE_H */
@@ -5,13 +5,9 @@
 #include "memory.h"
 #include "timer.h"
 #include "vmemory.h"
-#include "display.h"
+#include "log.h"
 
 /* Constants from memory module */
-#ifndef PROGRAM_START
-#define PROGRAM_START 0x200
-#endif
-
 #ifndef FONTSET_ADDRESS
 #define FONTSET_ADDRESS 0x000
 #endif
@@ -20,7 +16,157 @@
 
 /* Forward declarations for opcode handlers (internal) */
 static uint16_t cpu_fetch(Cpu *c);
-static int cpu_decode_and_execute(Cpu *c, uint16_t op_code, const uint8_t input[16]);
+static inline uint16_t cpu_peek(const Cpu *c, uint16_t addr);
+static void cpu_skip(Cpu *c);
+static uint32_t vip_cycles(uint16_t op_code, uint8_t vx, bool skipped);
+
+/* Per profile quirk constants: chip8_shift_vy, schip_wrap, ... */
+#define X(name, shift_vy, mem_inc_i, vf_reset, jump_vx, wrap, display_wait) \
+    enum { name##_shift_vy = shift_vy, name##_mem_inc_i = mem_inc_i, name##_vf_reset = vf_reset, \
+           name##_jump_vx = jump_vx, name##_wrap = wrap, name##_display_wait = display_wait };
+QUIRK_PROFILES(X)
+#undef X
+
+/* xorshift32, deterministic Cxkk random bytes */
+static inline uint8_t cpu_random_byte(Cpu *c) {
+    uint32_t r = c->rng;
+    r ^= r << 13;
+    r ^= r >> 17;
+    r ^= r << 5;
+    c->rng = r;
+    return (uint8_t)(r >> 24);
+}
+
+/* Every I relative access wraps at the end of memory, a program can't read or write outside of it */
+#define MEM_ADDR(a) ((size_t)(a) & MEMORY_MASK)
+
+static inline void cpu_mem_write(Cpu *c, size_t addr, uint8_t value) {
+    addr = MEM_ADDR(addr);
+    c->memory.mem[addr] = value;
+    if (c->memory.track_dirty)//only once a snapshot was taken, see snapshot_restore
+        memory_mark_dirty(&c->memory, (uint32_t)addr, (uint32_t)addr + 1);
+}
+
+/* Dxyn sprite rows at I, gathered into tmp only when they run past the end of memory */
+static inline const uint8_t *cpu_sprite_data(Cpu *c, size_t len, uint8_t *tmp) {
+    if ((size_t)c->i + len <= MEMORY_SIZE)
+        return &c->memory.mem[c->i];
+    for (size_t k = 0; k < len; k++)
+        tmp[k] = c->memory.mem[MEM_ADDR(c->i + k)];
+    return tmp;
+}
+
+/* Ex9E/ExA1/Fx0A read key k: remember where it happened in the draw sequence (latency probe) */
+static inline void cpu_observe_key(Cpu *c, uint8_t k) {
+    if (!(c->key_observed & (1u << k))) {
+        c->key_observed |= (uint16_t)(1u << k);
+        c->key_observed_draws[k] = c->draws;
+    }
+}
+
+/*
+ * Idle loops, polling that can't end before the next 60Hz tick or keypad change:
+ *   L: 1L                jump to self (program halted)
+ *   L: Fx07, 3x00, 1L    wait for the delay timer, DT != 0
+ * (Fx0A does not loop, it blocks the CPU in the key_wait state)
+ * The whole iterations that fit in the remaining budget are accounted at once instead of run,
+ * leaving exactly the state running them would (pc back at L, instruction count, Vx = DT).
+ * A partial iteration is left to the interpreter. op_code is the opcode at pc, not fetched yet.
+ * Returns the budget consumed, 0 if pc is not at an idle loop.
+ */
+static inline int64_t cpu_idle_skip(Cpu *c, uint16_t op_code, int64_t room) {
+#ifdef CHIP8_NO_FUSE
+    return 0;//plain interpreter, to bisect a difference
+#endif
+    uint16_t pc = c->pc;
+    uint16_t x = (uint16_t)((op_code & 0x0F00) >> 8);
+    bool vip = c->timing == TIMING_VIP;
+    int64_t period, cost;
+
+    switch (op_code & 0xF000) {
+        case 0x1000:
+            if ((op_code & 0x0FFF) != pc)
+                return 0;
+            period = 1;
+            cost = vip ? vip_cycles(op_code, 0, false) : 1;
+            break;
+
+        case 0xF000:
+            if ((op_code & 0x00FF) == 0x07) {
+                uint16_t test = (uint16_t)(0x3000 | (x << 8));
+                uint8_t delay = timer_delay(&c->timer);
+                if (delay == 0 || pc > 0x0FFF ||
+                    cpu_peek(c, (uint16_t)(pc + 2)) != test || cpu_peek(c, (uint16_t)(pc + 4)) != (0x1000 | pc))
+                    return 0;
+                period = 3;
+                cost = vip ? (int64_t)vip_cycles(op_code, c->v[x], false) + vip_cycles(test, delay, false) +
+                             vip_cycles((uint16_t)(0x1000 | pc), 0, false)
+                           : 3;
+            } else {
+                return 0;
+            }
+            break;
+
+        default:
+            return 0;
+    }
+
+    int64_t loops = room / cost;
+    if (loops == 0)
+        return 0;
+    if (period == 3)
+        c->v[x] = timer_delay(&c->timer);//what every Fx07 of the loop stores
+    c->instructions += (uint64_t)(loops * period);
+    c->idle = true;
+    return loops * cost;
+}
+
+#define CPU_CAT_(a, b) a##b
+#define CPU_CAT(a, b) CPU_CAT_(a, b)
+#define CPU_EXEC_NAME(p) CPU_CAT(cpu_decode_and_execute_, p)
+#define QUIRK(q) CPU_CAT(PROFILE, CPU_CAT(_, q))
+#define PROFILE_FN(f) CPU_CAT(f, CPU_CAT(_, PROFILE)) //cpu_draw -> cpu_draw_schip
+#define CPU_RUN_NAME(p) CPU_CAT(cpu_run_, p)
+
+/* One specialized interpreter and run loop per profile, keep in sync with QUIRK_PROFILES */
+#define PROFILE chip8
+#include "cpu_exec.inc"
+#include "cpu_fuse.inc"
+#undef PROFILE
+#define PROFILE schip
+#include "cpu_exec.inc"
+#include "cpu_fuse.inc"
+#undef PROFILE
+#define PROFILE xochip
+#include "cpu_exec.inc"
+#include "cpu_fuse.inc"
+#undef PROFILE
+#define PROFILE legacy
+#include "cpu_exec.inc"
+#include "cpu_fuse.inc"
+#undef PROFILE
+
+typedef int (*CpuExecFn)(Cpu *c, uint16_t op_code, const uint8_t input[16]);
+
+static const CpuExecFn EXEC_TABLE[QUIRKS_COUNT] = {
+#define X(name, ...) [QUIRKS_##name] = CPU_EXEC_NAME(name),
+    QUIRK_PROFILES(X)
+#undef X
+};
+
+typedef int (*CpuRunFn)(Cpu *c, const uint8_t input[16], int64_t budget, int64_t *spent);
+
+static const CpuRunFn RUN_TABLE[QUIRKS_COUNT] = {
+#define X(name, ...) [QUIRKS_##name] = CPU_RUN_NAME(name),
+    QUIRK_PROFILES(X)
+#undef X
+};
+
+static const char *const PROFILE_NAMES[QUIRKS_COUNT] = {
+#define X(name, ...) [QUIRKS_##name] = #name,
+    QUIRK_PROFILES(X)
+#undef X
+};
 
 Cpu* cpu_new(Cpu *c, Memory *memory, Timer *timer, VMemory *vmemory) {
 
@@ -32,10 +178,61 @@ Cpu* cpu_new(Cpu *c, Memory *memory, Timer *timer, VMemory *vmemory) {
     c->sp = 0;
     memset(c->stack, 0, sizeof(c->stack));//16 16bit stack
     memset(c->v, 0, sizeof(c->v));//16 8bit General purpose registers VX
+    memset(c->audio_pattern, 0, sizeof(c->audio_pattern));
+    c->audio_pitch = AUDIO_PITCH_DEFAULT;
+    c->audio_dirty = false;
+
+    c->vblank_wait = false;
+    c->key_wait = false;
+    c->key_wait_reg = 0;
+    c->key_wait_key = -1;
+    c->key_wait_held = 0;
+    c->idle = false;
+    c->draws = 0;
+    c->key_observed = 0;
+    memset(c->key_observed_draws, 0, sizeof(c->key_observed_draws));
+    c->rng = 0x2545F491u;//any non-zero seed
 
     c->memory = *memory;
     c->timer = *timer;
     c->vmemory = *vmemory;
+
+    cpu_set_profile(c, DEFAULT_QUIRK_PROFILE);
+    cpu_set_timing(c, TIMING_INSTRUCTIONS);
+    return c;
+}
+
+int64_t cpu_frame_budget(TimingModel timing, uint64_t cpu_clock, uint64_t frame) {
+    if (timing == TIMING_VIP)
+        return VIP_FRAME_BUDGET;
+    //e.g. 700Hz -> 11,12,12,11,12,...
+    return (int64_t)(((frame + 1) * cpu_clock) / 60 - (frame * cpu_clock) / 60);
+}
+
+void cpu_set_timing(Cpu *c, TimingModel timing) {
+    if (!c) return;
+    c->timing = timing;
+    c->cycles = 0;
+    c->instructions = 0;
+}
+
+/* Select the interpreter once, the hot path never checks quirks at runtime */
+void cpu_set_profile(Cpu *c, QuirkProfile profile) {
+    if (!c || profile >= QUIRKS_COUNT) return;
+    c->profile = profile;
+    c->exec = EXEC_TABLE[profile];
+}
+
+int quirk_profile_from_str(const char *s, QuirkProfile *out_profile) {
+    if (!s || !out_profile) return 1;
+    for (int p = 0; p < QUIRKS_COUNT; p++) {
+        if (strcmp(s, PROFILE_NAMES[p]) == 0) {
+            *out_profile = (QuirkProfile)p;
+            return 0;
+        }
+    }
+    fprintf(stderr, "[profile-quirks] \"%s\" is not known. Use chip8, schip, xochip or legacy\n", s);
+    return 1;
 }
 
 void cpu_free(Cpu *cpu) {
@@ -45,13 +242,111 @@ void cpu_free(Cpu *cpu) {
     free(cpu);
 }
 
+/*
+ * COSMAC VIP machine cycles per instruction (8 clocks each at 1.7609MHz), including the
+ * interpreter fetch/decode overhead. Approximate figures after published analyses of the
+ * VIP interpreter routines; XO-CHIP opcodes never ran on a VIP and use the base cost.
+ * vx is Vx before execution, skipped tells if a skip instruction took the skip.
+ */
+#define VIP_FETCH_DECODE 68
+
+static uint32_t vip_cycles(uint16_t op_code, uint8_t vx, bool skipped) {
+    uint8_t n = (uint8_t)(op_code & 0x000F);
+    uint8_t x = (uint8_t)((op_code & 0x0F00) >> 8);
+    uint32_t cost;
+
+    switch (op_code & 0xF000) {
+        case 0x0000: cost = (op_code == 0x00E0) ? 3078 : 10; break;//clear writes all 256 display bytes
+        case 0x1000: cost = 12; break;
+        case 0x2000: cost = 26; break;
+        case 0x3000:
+        case 0x4000: cost = skipped ? 14 : 10; break;
+        case 0x5000:
+        case 0x9000: cost = skipped ? 18 : 14; break;
+        case 0x6000: cost = 6; break;
+        case 0x7000: cost = 10; break;
+        case 0x8000: cost = 44; break;
+        case 0xA000: cost = 12; break;
+        case 0xB000: cost = 22; break;
+        case 0xC000: cost = 36; break;
+        case 0xD000:
+            /* Byte aligned sprites are copied as is, otherwise every row is shifted into
+               two display bytes first */
+            cost = 26 + (uint32_t)n * (((vx & 7) == 0) ? 20 : 34);
+            break;
+        case 0xE000: cost = skipped ? 18 : 14; break;
+        case 0xF000:
+            switch (op_code & 0x00FF) {
+                case 0x07: cost = 10; break;
+                case 0x0A: cost = 19; break;
+                case 0x15:
+                case 0x18: cost = 10; break;
+                case 0x1E:
+                case 0x29: cost = 16; break;
+                case 0x33: cost = 80 + 16u * (uint32_t)(vx / 100 + (vx / 10) % 10 + vx % 10); break;//one loop per unit counted
+                case 0x55:
+                case 0x65: cost = 14 + 14u * (uint32_t)(x + 1); break;
+                default:   cost = 0; break;
+            }
+            break;
+        default: cost = 0; break;
+    }
+    return VIP_FETCH_DECODE + cost;
+}
+
+/* fetch-decode-execute one instruction and record its cost */
+static inline int cpu_step(Cpu *c, const uint8_t input[16]) {
+    uint16_t op_code = cpu_fetch(c);
+    if (c->timing == TIMING_VIP) {
+        uint16_t pc_next = c->pc;
+        uint8_t vx = c->v[(op_code & 0x0F00) >> 8];
+        int rc = c->exec(c, op_code, input);
+        c->cycles = vip_cycles(op_code, vx, c->pc != pc_next);
+        return rc;
+    }
+    c->cycles = 1;
+    return c->exec(c, op_code, input);
+}
+
+/* Fx0A: a key counts when it goes down after the wait started and comes back up (COSMAC VIP).
+   Returns true while the CPU is still blocked. */
+static bool cpu_key_wait_update(Cpu *c, const uint8_t input[16]) {
+    uint16_t down = keypad_to_bits(input);
+    c->key_wait_held &= down;//a key held at Fx0A counts after it was released once
+
+    if (c->key_wait_key < 0) {
+        uint16_t pressed = (uint16_t)(down & ~c->key_wait_held);
+        for (int k = 0; k <= 0xF; k++) {
+            if (pressed & (1u << k)) {
+                c->key_wait_key = (int8_t)k;
+                cpu_observe_key(c, (uint8_t)k);//the press is seen now, the value arrives on release
+                break;
+            }
+        }
+        return true;
+    }
+    if (down & (1u << c->key_wait_key))
+        return true;//wait for the release
+
+    cpu_observe_key(c, (uint8_t)c->key_wait_key);//the release
+    c->v[c->key_wait_reg] = (uint8_t)c->key_wait_key;
+    c->key_wait = false;
+    return false;
+}
+
 /* Public API: cpu_cycle */
-int cpu_cycle(Cpu *cpu, const uint8_t input[16], DisplayHandler *out) {
+int cpu_cycle(Cpu *cpu, const uint8_t input[16], EmulatorState *out) {
     if (!cpu || !input || !out) return 1;
 
+    /* Display wait quirk: the draw already happened, stall until the next 60Hz tick */
+    if (cpu->vblank_wait || (cpu->key_wait && cpu_key_wait_update(cpu, input))) {
+        out->draw_pixels = NULL;
+        return 0;
+    }
+
     /* fetch-decode-execute */
-    uint16_t op_code = cpu_fetch(cpu);
-    int rc = cpu_decode_and_execute(cpu, op_code, input);
+    int rc = cpu_step(cpu, input);
+    cpu->instructions++;
     if (rc != 0) 
         return rc;
 
@@ -66,10 +361,61 @@ int cpu_cycle(Cpu *cpu, const uint8_t input[16], DisplayHandler *out) {
     return 0;
 }
 
-/* Update timer 60hz */
-int cpu_update_timers(Cpu *cpu) {
-    if (!cpu) return 0;
-    return timer_update(&cpu->timer) ? 1 : 0;
+/* Start of cpu_run_frame: move the timers to 'frame' and handle Fx0A. Returns true if the CPU stays blocked */
+static bool cpu_frame_begin(Cpu *cpu, const uint8_t input[16], uint64_t frame, int64_t budget, int64_t *spent) {
+    if (frame != cpu->timer.frame) {
+        cpu->timer.frame = frame;//timers are computed from it when read
+        cpu->vblank_wait = false;//vertical blank, a waiting draw may continue
+    }
+    cpu->idle = false;
+    if (cpu->key_wait && cpu_key_wait_update(cpu, input)) {
+        *spent = budget > 0 ? budget : 0;//blocked the whole frame, nothing is executed
+        cpu->idle = true;
+        return true;
+    }
+    return false;
+}
+
+/* One instruction at a time through cpu->exec, optionally skipping idle loops */
+static int cpu_run_plain(Cpu *cpu, const uint8_t input[16], int64_t budget, int64_t *spent, bool skip_idle,
+                         CpuTraceFn trace, void *user) {
+    int64_t used = 0;
+    int rc = 0;
+
+    while (used < budget && !cpu->vblank_wait && !cpu->key_wait) {
+        if (skip_idle) {
+            int64_t idle = cpu_idle_skip(cpu, cpu_peek(cpu, cpu->pc), budget - used);
+            if (idle) {
+                used += idle;
+                continue;
+            }
+        }
+        if (trace)
+            trace(user, cpu->pc, cpu_peek(cpu, cpu->pc));
+        rc = cpu_step(cpu, input);
+        used += cpu->cycles;
+        cpu->instructions++;
+        if (rc != 0)
+            break;
+    }
+    *spent = used;
+    return rc;
+}
+
+/* Public API: cpu_run_frame, the scheduler's hot loop */
+int cpu_run_frame(Cpu *cpu, const uint8_t input[16], uint64_t frame, int64_t budget, int64_t *spent) {
+    if (cpu_frame_begin(cpu, input, frame, budget, spent))
+        return 0;
+    if (cpu->timing == TIMING_INSTRUCTIONS)
+        return RUN_TABLE[cpu->profile](cpu, input, budget, spent);//direct calls and superinstructions
+    return cpu_run_plain(cpu, input, budget, spent, true, NULL, NULL);
+}
+
+int cpu_run_frame_reference(Cpu *cpu, const uint8_t input[16], uint64_t frame, int64_t budget, int64_t *spent,
+                            CpuTraceFn trace, void *user) {
+    if (cpu_frame_begin(cpu, input, frame, budget, spent))
+        return 0;
+    return cpu_run_plain(cpu, input, budget, spent, false, trace, user);
 }
 
 /* --- internal helpers --- */
@@ -78,249 +424,21 @@ static uint16_t cpu_fetch(Cpu *c) {
     uint16_t pc = c->pc;
     /* Read two bytes (big-endian) */
     uint16_t b1 = (uint16_t)c->memory.mem[pc];
-    uint16_t b2 = (uint16_t)c->memory.mem[pc + 1];
+    uint16_t b2 = (uint16_t)c->memory.mem[MEM_ADDR(pc + 1)];//pc = 0xFFFF wraps
     c->pc += 2;
     return (uint16_t)((b1 << 8) | b2);
 }
 
+static inline uint16_t cpu_peek(const Cpu *c, uint16_t addr) {
+    return (uint16_t)((c->memory.mem[addr] << 8) | c->memory.mem[MEM_ADDR(addr + 1)]);
+}
 
-static int cpu_decode_and_execute(Cpu *c, uint16_t op_code, const uint8_t input[16]) {
-    uint8_t n = (uint8_t)(op_code & 0x000F);//first nibble, 4 bit number
-    size_t y = (size_t)((op_code & 0x00F0) >> 4);//second nibble, look one of 16 vx registers
-    size_t x = (size_t)((op_code & 0x0F00) >> 8);//third nibble, look one of 16 vx registers
-    uint8_t kk = (uint8_t)(op_code & 0x00FF);//3rd, 4th nibble, 8 bit immediate number
-    uint16_t nnn = (uint16_t)(op_code & 0x0FFF);//2nd, 3rd and 4th nibble, 12 bit immediate memory address
-    /*
-        CHIP-8 uses post incremental stack, meaning:
-            push: write to stack[sp] then sp++
-            pop: sp-- then read froms stack[sp]
-        size_t type is used for indexing
-        uint8_t type is used for represent registers
-    */
-
-    int unrecognized = 0;
-
-    switch (op_code & 0xF000) {//1st nibble, kind of instruction
-        case 0x0000:
-            switch (op_code) {
-                case 0x00E0: //CLEAR
-                    vmemory_clear(&c->vmemory);
-                    break;
-                case 0x00EE: //RETURN FROM SUBROUTINE
-                    if (c->sp == 0) {
-                        return -1; /* stack underflow */
-                    }
-                    c->sp -= 1;
-                    c->pc = c->stack[c->sp];
-                    break;
-                default:
-                    /* 0NNN - SYS addr (ignored) */
-                    unrecognized = 1;
-            }
-            break;
-
-        case 0x1000: //JUMP
-            c->pc = nnn;//One way jump no build-in wayback
-            break;
-
-        case 0x2000: //SUB ROUTINES
-            if (c->sp >= STACK_SIZE) 
-                return -1; /* stack overflow */
-            c->stack[c->sp] = c->pc; //save PC to stack
-            c->sp += 1;//increment sp
-            c->pc = nnn;
-            break;
-
-        case 0x3000: /* SE Vx, byte SKIP*/
-            if (c->v[x] == kk) c->pc += 2;
-            break;
-
-        case 0x4000: /* SNE Vx, byte SKIP*/
-            if (c->v[x] != kk) c->pc += 2;
-            break;
-
-        case 0x5000: /* SE Vx, Vy (last nibble must be 0) */
-            if (n == 0) {
-                if (c->v[x] == c->v[y]) c->pc += 2;
-            } else {
-                unrecognized = 1;
-            }
-            break;
-
-        case 0x6000: /* LD Vx, byte */
-            c->v[x] = kk;
-            break;
-
-        case 0x7000: /* ADD Vx, byte */
-            c->v[x] = (uint8_t)(c->v[x] + kk);//overflow can happen 250+10=256 mod 256=4, but its intentional
-            break;
-
-        case 0x8000:
-            switch (n) {
-                case 0x0: /* LD Vx, Vy */
-                    c->v[x] = c->v[y];
-                    break;
-                case 0x1: /* OR Vx, Vy */
-                    c->v[x] = c->v[x] | c->v[y];
-                    break;
-                case 0x2: /* AND Vx, Vy */
-                    c->v[x] = c->v[x] & c->v[y];
-                    break;
-                case 0x3: /* XOR Vx, Vy */
-                    c->v[x] = c->v[x] ^ c->v[y];
-                    break;
-                case 0x4: { /* ADD Vx, Vy with carry */
-                    uint16_t res = (uint16_t)c->v[x] + (uint16_t)c->v[y];
-                    c->v[0xF] = (res > 0xFF) ? 1 : 0;
-                    c->v[x] = (uint8_t)res;
-                    break;
-                }
-                case 0x5: { /* SUB Vx, Vy - VF = NOT borrow */
-                    uint8_t vx = c->v[x];
-                    uint8_t vy = c->v[y];
-                    c->v[0xF] = (vx > vy) ? 1 : 0;
-                    c->v[x] = (uint8_t)(vx - vy);
-                    break;
-                }
-                case 0x6: /* SHR Vx {, Vy} - Save the LSB of VX in VF, before shift VX by 1  */
-                    c->v[0xF] = c->v[x] & 0x1;
-                    c->v[x] >>= 1;
-                    break;
-                case 0x7: { /* SUBN Vx, Vy - VF = NOT borrow of Vy - Vx */
-                    uint8_t vx = c->v[x];
-                    uint8_t vy = c->v[y];
-                    c->v[0xF] = (vy > vx) ? 1 : 0;
-                    c->v[x] = (uint8_t)(vy - vx);
-                    break;
-                }
-                case 0xE: /* SHL Vx {, Vy} - VF = MSB prior to shift */
-                    c->v[0xF] = (c->v[x] & 0x80) >> 7;
-                    c->v[x] <<= 1;
-                    break;
-                default:
-                    unrecognized = 1;
-            }
-            break;
-
-        case 0x9000: /* SNE Vx, Vy */
-            if (n == 0) {
-                if (c->v[x] != c->v[y]) c->pc += 2;
-            } else {
-                unrecognized = 1;
-            }
-            break;
-
-        case 0xA000: /* LD I, addr */
-            c->i = nnn;
-            break;
-
-        case 0xB000: /* JP V0, addr */
-            c->pc = (uint16_t)(nnn + (uint16_t)c->v[0]);
-            break;
-
-        case 0xC000: /* RND Vx, byte */
-            c->v[x] = (uint8_t)((uint8_t)(rand() % 256) & kk);
-            break;
-
-        case 0xD000: { /* DRW Vx, Vy, nibble */
-            uint16_t start = (uint16_t)c->i;
-            uint16_t end = start + (uint16_t)n;
-            /* draw_sprite_no_wrap expects pointer to sprite bytes and sprite height n */
-            c->v[0xF] = vmemory_draw_sprite_no_wrap(&c->vmemory, c->v[x], c->v[y], &c->memory.mem[start], (int)n);
-            break;
-        }
-
-        case 0xE000:
-            switch (op_code & 0x00FF) {
-                case 0x9E: /* SKP Vx */
-                    if (input[c->v[x]] != 0) c->pc += 2;
-                    break;
-                case 0xA1: /* SKNP Vx */
-                    if (input[c->v[x]] == 0) c->pc += 2;
-                    break;
-                default:
-                    unrecognized = 1;
-            }
-            break;
-
-        case 0xF000:
-            switch (op_code & 0x00FF) {
-                case 0x07: /* LD Vx, DT */
-                    c->v[x] = c->timer.delay_timer;
-                    break;
-
-                case 0x0A: { /* LD Vx, K - wait for key press, store in Vx */
-                    int found = -1;
-                    for (int k = 0; k <= 0xF; ++k) {
-                        if (input[k] != 0) { 
-                            found = k; 
-                            break; 
-                        }
-                    }
-                    if (found < 0) {
-                        /* No key pressed: step PC back 2 bytes to re-execute this instruction */
-                        c->pc -= 2;
-                    } else {
-                        c->v[x] = (uint8_t)found;
-                    }
-                    break;
-                }
-
-                case 0x15: /* LD DT, Vx */
-                    c->timer.delay_timer = c->v[x];
-                    break;
-
-                case 0x18: /* LD ST, Vx */
-                    c->timer.sound_timer = c->v[x];
-                    break;
-
-                case 0x1E: /* ADD I, Vx */
-                    c->i = (uint16_t)(c->i + (uint16_t)c->v[x]);
-                    break;
-
-                case 0x29: /* LD F, Vx */
-                    {
-                        uint16_t nibble = (uint16_t)(c->v[x] & 0x0F);
-                        c->i = (uint16_t)(FONTSET_ADDRESS + 5 * nibble);//4x5 pixel stores 5 bytes, one byte per row
-                    }
-                    break;
-
-                case 0x33: /* LD B, Vx (BCD) */
-                    {
-                        uint8_t tmp = c->v[x];
-                        c->memory.mem[c->i + 0] = tmp / 100;//100th digit
-                        c->memory.mem[c->i + 1] = (tmp / 10) % 10;//10th digit
-                        c->memory.mem[c->i + 2] = tmp % 10;//1th digit
-                    }
-                    break;
-
-                case 0x55: /* LD [I], Vx */
-                    for (size_t nidx = 0; nidx <= x; ++nidx) {
-                        c->memory.mem[(size_t)c->i + nidx] = c->v[nidx];
-                    }
-                    break;
-
-                case 0x65: /* LD Vx, [I] */
-                    for (size_t nidx = 0; nidx <= x; ++nidx) {
-                        c->v[nidx] = c->memory.mem[(size_t)c->i + nidx];
-                    }
-                    break;
-
-                default:
-                    unrecognized = 1;
-            }
-            break;
-
-        default:
-            unrecognized = 1;
-    }
-
-    if (unrecognized) {
-        /* Report as an error similar to Rust Err */
-        fprintf(stderr, "Instruction 0x%04X unknown\n", op_code);
-        return -1;
-    }
-
-    return 0;
+/* Skip next instruction, XO-CHIP F000 nnnn is 4 bytes long so it must be skipped as a whole */
+static void cpu_skip(Cpu *c) {
+    if (c->memory.mem[c->pc] == 0xF0 && c->memory.mem[MEM_ADDR(c->pc + 1)] == 0x00)
+        c->pc += 4;
+    else
+        c->pc += 2;
 }
 
+
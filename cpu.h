@@ -3,16 +3,56 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <stdbool.h>
 
 /* External dependencies (assumed provided elsewhere in your project) */
 #include "memory.h"   // Memory { uint8_t *mem; }
-#include "timer.h"    // Timer { uint8_t delay_timer; uint8_t sound_timer; } + timer_init/update
+#include "timer.h"    // Timer, lazy delay/sound timers + timer_init
 #include "vmemory.h"  // VMemory + vmemory_clear + vmemory_draw_sprite_no_wrap
 //#include "random_byte.h" // RandomByte + random_byte_sample + random_byte_init
-#include "display.h"
 
 #define STACK_SIZE 16
 #define V_REG_COUNT 16
+#define AUDIO_PATTERN_SIZE 16 //XO-CHIP 128 x 1-bit audio samples
+#define AUDIO_PITCH_DEFAULT 64 //4000Hz playback rate
+
+/* Quirk profiles, behaviour that differs between CHIP-8 implementations.
+ *   shift_vy:     8xy6/8xyE shift Vy into Vx (else Vx in place)
+ *   mem_inc_i:    Fx55/Fx65 leave I = I + x + 1
+ *   vf_reset:     8xy1/8xy2/8xy3 reset VF to 0
+ *   jump_vx:      Bxnn jumps to xnn + Vx (else Bnnn jumps to nnn + V0)
+ *   wrap:         sprites wrap around the screen edges (else clipped)
+ *   display_wait: Dxyn waits for the next 60Hz vertical blank
+ * name,  shift_vy, mem_inc_i, vf_reset, jump_vx, wrap, display_wait
+ */
+#define QUIRK_PROFILES(X) \
+    X(chip8,  1, 1, 1, 0, 0, 1) \
+    X(schip,  0, 0, 0, 1, 0, 0) \
+    X(xochip, 1, 1, 0, 0, 1, 0) \
+    X(legacy, 0, 0, 0, 0, 0, 0)
+
+typedef enum {
+#define X(name, ...) QUIRKS_##name,
+    QUIRK_PROFILES(X)
+#undef X
+    QUIRKS_COUNT
+} QuirkProfile;
+
+#define DEFAULT_QUIRK_PROFILE QUIRKS_legacy //what this interpreter always did, the others are opt-in
+
+/* How the scheduler measures CPU work.
+ *   TIMING_INSTRUCTIONS: every opcode costs 1, the frame budget is cpu_clock / 60 instructions
+ *   TIMING_VIP:          every opcode costs its COSMAC VIP machine cycles, the frame budget is
+ *                        the machine cycles the VIP interpreter gets per 60Hz frame
+ */
+typedef enum {
+    TIMING_INSTRUCTIONS,
+    TIMING_VIP
+} TimingModel;
+
+#define VIP_CYCLES_PER_FRAME 3668 //1.7609MHz / 8 clocks per machine cycle / 60Hz
+#define VIP_FRAME_OVERHEAD 1024 //display DMA steals one machine cycle per displayed byte (128 lines x 8 bytes)
+#define VIP_FRAME_BUDGET (VIP_CYCLES_PER_FRAME - VIP_FRAME_OVERHEAD)
 
 typedef struct {
     /* If draw_pixels is NULL -> no draw update.
@@ -27,6 +67,26 @@ struct Cpu {
     uint16_t stack[STACK_SIZE];
     uint8_t v[V_REG_COUNT];//General purpose registers v[x]x:0toF
 
+    uint8_t audio_pattern[AUDIO_PATTERN_SIZE];//XO-CHIP F002 sample buffer
+    uint8_t audio_pitch;//XO-CHIP Fx3A playback pitch
+    bool audio_dirty;//pattern or pitch changed since the sound module last picked it up
+    bool vblank_wait;//display wait quirk, set by Dxyn and cleared on the next timer tick
+
+    QuirkProfile profile;
+    TimingModel timing;
+    uint32_t cycles;//cost of the last instruction, 1 or VIP machine cycles
+    uint64_t instructions;//instructions executed since reset
+    bool key_wait;//Fx0A: blocked until a key is pressed and released
+    uint8_t key_wait_reg;//Vx that gets the key
+    int8_t key_wait_key;//key pressed during the wait, -1 while none
+    uint16_t key_wait_held;//keys already down when the wait started, they must be released first
+    bool idle;//the last cpu_run_frame ended in a polling loop (see cpu_idle_skip) or blocked in key_wait
+    uint32_t draws;//Dxyn and 00E0 executed since reset (latency probe)
+    uint16_t key_observed;//keys read by Ex9E/ExA1/Fx0A since the latency probe last cleared it
+    uint32_t key_observed_draws[16];//'draws' when the key was first read
+    uint32_t rng;//Cxkk random state, per CPU so runs are reproducible and instances independent
+    int (*exec)(struct Cpu *c, uint16_t op_code, const uint8_t input[16]);//interpreter specialized for profile
+
     Memory memory;
     Timer timer;
     VMemory vmemory;
@@ -38,13 +98,58 @@ typedef struct Cpu Cpu;
 Cpu * cpu_new(Cpu *c, Memory *memory, Timer *timer, VMemory *vmemory);
 void cpu_free(Cpu *cpu);
 
+/* Select the specialized interpreter for a quirk profile (cpu_new selects DEFAULT_QUIRK_PROFILE) */
+void cpu_set_profile(Cpu *c, QuirkProfile profile);
+
+/* Parse profile name (chip8, schip, xochip, legacy).
+ * Returns 0 on success, non-zero on error (and prints an error message).
+ */
+int quirk_profile_from_str(const char *s, QuirkProfile *out_profile);
+
 /* Execute one CPU cycle. 'input' must be an array of 16 uint8_t values (0 or 1).
  * On success returns 0 and fills 'out' (out->draw_pixels == NULL if nothing to draw).
  * On error returns non-zero and out content is unspecified.
  */
-int cpu_cycle(Cpu *cpu, const uint8_t input[16], DisplayHandler *out);
+int cpu_cycle(Cpu *cpu, const uint8_t input[16], EmulatorState *out);
+
+/* Execute instructions of 60Hz frame number 'frame' until 'budget' (in units of the timing model)
+ * is spent or the CPU stalls on the display wait quirk. A new frame number moves the timers and
+ * ends the display wait, calling again with the same frame continues it (debugger).
+ * The last instruction may overshoot the budget, the scheduler carries the difference over to the
+ * next frame. 'spent' receives the cost of the executed instructions.
+ * Returns 0 on success, non-zero if an instruction failed (execution stops after it).
+ */
+int cpu_run_frame(Cpu *cpu, const uint8_t input[16], uint64_t frame, int64_t budget, int64_t *spent);
+
+/* Called with pc and the opcode there before every instruction of the reference interpreter */
+typedef void (*CpuTraceFn)(void *user, uint16_t pc, uint16_t op_code);
+
+/* Reference for --validate: cpu_run_frame with the plain profile interpreter (cpu_decode_and_execute_*),
+ * one instruction at a time, no superinstructions and no idle loop skipping. Must leave exactly the
+ * state cpu_run_frame leaves. 'trace' may be NULL.
+ */
+int cpu_run_frame_reference(Cpu *cpu, const uint8_t input[16], uint64_t frame, int64_t budget, int64_t *spent,
+                            CpuTraceFn trace, void *user);
+
+/* Select the timing model (cpu_new selects TIMING_INSTRUCTIONS) */
+void cpu_set_timing(Cpu *c, TimingModel timing);
+
+/* CPU work allowed in frame number 'frame', in units of the timing model:
+ * VIP_FRAME_BUDGET cycles, or cpu_clock instructions per second spread evenly over 60 frames.
+ */
+int64_t cpu_frame_budget(TimingModel timing, uint64_t cpu_clock, uint64_t frame);
+
+/* Keypad as 16 bits (bit k = key k pressed) <-> 16 uint8_t values (0 or 1) */
+static inline uint16_t keypad_to_bits(const uint8_t keypad[16]) {
+    uint16_t bits = 0;
+    for (int k = 0; k < 16; k++)
+        bits |= (uint16_t)((keypad[k] ? 1u : 0u) << k);
+    return bits;
+}
 
-/* Update timers (to be called at 60Hz). Returns 1 if sound timer caused a beep, 0 otherwise. */
-int cpu_update_timers(Cpu *cpu);
+static inline void keypad_from_bits(uint16_t bits, uint8_t keypad[16]) {
+    for (int k = 0; k < 16; k++)
+        keypad[k] = (uint8_t)((bits >> k) & 1u);
+}
 
 #endif
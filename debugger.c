@@ -1,17 +1,22 @@
 // debugger.c
 #include "debugger.h"
 #include "cpu.h"
+#include "log.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <stdbool.h>
 
 Debugger dbg;
 
+static void history_reset(void);
+
 void debugger_init(void) {
     dbg.enabled    = true;
     dbg.paused     = false;
     dbg.step       = false;
     dbg.breakpoint = 0;
+    history_reset();//a new run, the old history doesn't lead here
 }
 
 /*
@@ -24,28 +29,28 @@ void debugger_handle_event(char key, Cpu *c) {
     switch (key) {
         case 'o':   // pause
             dbg.paused = true;
-            fprintf(stdout,"[DBG] Paused\n");
+            log_printf("[DBG] Paused\n");
             break;
 
         case 'u':   // resume
             dbg.paused = false;
-             fprintf(stdout,"[DBG] Resumed\n");
+            log_printf("[DBG] Resumed\n");
             break;
 
         case 'i':   // step
             dbg.step   = true;
             dbg.paused = true;
-            fprintf(stdout,"[DBG] Step\n");
+            log_printf("[DBG] Step\n");
             break;
 
         case 'b':   // breakpoint at current PC
             dbg.breakpoint = c->pc;
-            fprintf(stdout,"[DBG] Breakpoint set at 0x%03X\n", dbg.breakpoint);
+            log_printf("[DBG] Breakpoint set at 0x%03X\n", dbg.breakpoint);
             break;
 
         case 'n':   // clear breakpoint
             dbg.breakpoint = 0;
-            fprintf(stdout,"[DBG] Breakpoint cleared\n");
+            log_printf("[DBG] Breakpoint cleared\n");
             break;
 
         default:
@@ -57,18 +62,17 @@ void debugger_handle_event(char key, Cpu *c) {
  * Print CPU state
  */
 void debugger_print_state(Cpu *c) {
-    fprintf(stdout,"PC: %03X  I: %03X\n", c->pc, c->i);
+    log_printf("PC: %03X  I: %03X\n", c->pc, c->i);
 
-    for (int i = 0; i < 16; i++) {
-        fprintf(stdout,"V%X:%02X ", i, c->v[i]);
-        if ((i & 3) == 3) fprintf(stdout,"\n");
-    }
+    for (int i = 0; i < 16; i += 4)//one line per log call, lines never interleave
+        log_printf("V%X:%02X V%X:%02X V%X:%02X V%X:%02X\n",
+                   i, c->v[i], i + 1, c->v[i + 1], i + 2, c->v[i + 2], i + 3, c->v[i + 3]);
 
-    fprintf(stdout,"DT:%02X  ST:%02X\n",
-           c->timer.delay_timer,
-           c->timer.sound_timer);
+    log_printf("DT:%02X  ST:%02X\n",
+           timer_delay(&c->timer),
+           timer_sound(&c->timer));
 
-    fprintf(stdout,"---------------------------------\n");
+    log_printf("---------------------------------\n");
 }
 
 /*
@@ -78,15 +82,15 @@ bool debugger_should_execute(Cpu *c) {
     if (!dbg.enabled)
         return true;
 
-    if (dbg.breakpoint && c->pc == dbg.breakpoint) {
+    if (dbg.breakpoint && c->pc == dbg.breakpoint && !dbg.paused) {
         dbg.paused = true;
-        fprintf(stdout,"\n[DBG] BREAK @ PC=0x%03X\n", c->pc);
+        log_printf("\n[DBG] BREAK @ PC=0x%03X\n", c->pc);
         debugger_print_state(c);
     }
 
     if (dbg.step) {
         dbg.step = false;
-        fprintf(stdout,"\n[DBG] STEP @ PC=0x%03X\n", c->pc);
+        log_printf("\n[DBG] STEP @ PC=0x%03X\n", c->pc);
         debugger_print_state(c);
         return true;
     }
@@ -94,3 +98,493 @@ bool debugger_should_execute(Cpu *c) {
     return !dbg.paused;
 }
 
+void debugger_disassemble(uint16_t op, char *out, size_t len) {
+    unsigned x = (op >> 8) & 0xF, y = (op >> 4) & 0xF, n = op & 0xF, kk = op & 0xFF, nnn = op & 0xFFF;
+    switch (op & 0xF000) {
+        case 0x0000:
+            if (op == 0x00E0) snprintf(out, len, "CLS");
+            else if (op == 0x00EE) snprintf(out, len, "RET");
+            else snprintf(out, len, "SYS %03X", nnn);
+            return;
+        case 0x1000: snprintf(out, len, "JP %03X", nnn); return;
+        case 0x2000: snprintf(out, len, "CALL %03X", nnn); return;
+        case 0x3000: snprintf(out, len, "SE V%X, %02X", x, kk); return;
+        case 0x4000: snprintf(out, len, "SNE V%X, %02X", x, kk); return;
+        case 0x5000:
+            if (n == 0) { snprintf(out, len, "SE V%X, V%X", x, y); return; }
+            if (n == 2) { snprintf(out, len, "SAVE V%X-V%X", x, y); return; }
+            if (n == 3) { snprintf(out, len, "LOAD V%X-V%X", x, y); return; }
+            break;
+        case 0x6000: snprintf(out, len, "LD V%X, %02X", x, kk); return;
+        case 0x7000: snprintf(out, len, "ADD V%X, %02X", x, kk); return;
+        case 0x8000: {
+            static const char *const ALU[16] = {
+                "LD", "OR", "AND", "XOR", "ADD", "SUB", "SHR", "SUBN",
+                NULL, NULL, NULL, NULL, NULL, NULL, "SHL", NULL
+            };
+            if (!ALU[n]) break;
+            snprintf(out, len, "%s V%X, V%X", ALU[n], x, y);
+            return;
+        }
+        case 0x9000:
+            if (n != 0) break;
+            snprintf(out, len, "SNE V%X, V%X", x, y);
+            return;
+        case 0xA000: snprintf(out, len, "LD I, %03X", nnn); return;
+        case 0xB000: snprintf(out, len, "JP V0, %03X", nnn); return;
+        case 0xC000: snprintf(out, len, "RND V%X, %02X", x, kk); return;
+        case 0xD000: snprintf(out, len, "DRW V%X, V%X, %X", x, y, n); return;
+        case 0xE000:
+            if (kk == 0x9E) { snprintf(out, len, "SKP V%X", x); return; }
+            if (kk == 0xA1) { snprintf(out, len, "SKNP V%X", x); return; }
+            break;
+        case 0xF000:
+            switch (kk) {
+                case 0x00: if (x == 0) { snprintf(out, len, "LD I, LONG"); return; } break;
+                case 0x01: snprintf(out, len, "PLANE %X", x); return;
+                case 0x02: if (x == 0) { snprintf(out, len, "AUDIO"); return; } break;
+                case 0x3A: snprintf(out, len, "PITCH V%X", x); return;
+                case 0x07: snprintf(out, len, "LD V%X, DT", x); return;
+                case 0x0A: snprintf(out, len, "LD V%X, K", x); return;
+                case 0x15: snprintf(out, len, "LD DT, V%X", x); return;
+                case 0x18: snprintf(out, len, "LD ST, V%X", x); return;
+                case 0x1E: snprintf(out, len, "ADD I, V%X", x); return;
+                case 0x29: snprintf(out, len, "LD F, V%X", x); return;
+                case 0x33: snprintf(out, len, "LD B, V%X", x); return;
+                case 0x55: snprintf(out, len, "LD [I], V%X", x); return;
+                case 0x65: snprintf(out, len, "LD V%X, [I]", x); return;
+                default: break;
+            }
+            break;
+    }
+    snprintf(out, len, "???");
+}
+
+/*
+ * Overlay text: a built-in 3x5 font, one octal digit per row (4 = left pixel, 1 = right pixel)
+ */
+#define GLYPH_W 3
+#define GLYPH_H 5
+#define OVERLAY_LINES 17 //registers, timers, stack, blank, disassembly
+#define OVERLAY_COLUMNS 26
+#define DISASM_BEFORE 3 //instructions shown before PC
+#define DISASM_LINES 8
+#define RECT_BATCH 1024
+
+static const uint16_t GLYPH_DIGITS[10] = {
+    075557, 026227, 071747, 071317, 055711, 074717, 074757, 071122, 075757, 075717
+};
+static const uint16_t GLYPH_LETTERS[26] = {
+    025755, 065656, 034443, 065556, 074647, 074644, 034553, 055755, 072227, 011152, 055655, 044447, 057755,
+    065555, 025552, 065644, 025563, 065655, 034216, 072222, 055557, 055552, 055775, 055255, 055222, 071247
+};
+
+static uint16_t glyph(char ch) {
+    if (ch >= '0' && ch <= '9') return GLYPH_DIGITS[ch - '0'];
+    if (ch >= 'A' && ch <= 'Z') return GLYPH_LETTERS[ch - 'A'];
+    switch (ch) {
+        case ' ': return 0;
+        case ':': return 002020;
+        case ',': return 000024;
+        case '[': return 064446;
+        case ']': return 031113;
+        case '>': return 042124;
+        case '*': return 005250;
+        case '-': return 000700;
+        case '+': return 002720;
+        case '.': return 000002;
+        default:  return 071202;//?
+    }
+}
+
+/* Lit pixels of the text as rects, drawn with one SDL_RenderFillRects per batch */
+typedef struct {
+    SDL_Renderer *renderer;
+    SDL_Rect rects[RECT_BATCH];
+    int count;
+    int px;//size of a font pixel in window pixels
+} TextBatch;
+
+static void text_flush(TextBatch *t) {
+    if (t->count)
+        SDL_RenderFillRects(t->renderer, t->rects, t->count);
+    t->count = 0;
+}
+
+static void text_draw(TextBatch *t, int x, int y, const char *s) {
+    for (; *s; s++, x += (GLYPH_W + 1) * t->px) {
+        uint16_t g = glyph(*s);
+        for (int row = 0; row < GLYPH_H; row++) {
+            for (int col = 0; col < GLYPH_W; col++) {
+                if (!(g & (1u << ((GLYPH_H - 1 - row) * 3 + (GLYPH_W - 1 - col)))))
+                    continue;
+                if (t->count == RECT_BATCH)
+                    text_flush(t);
+                SDL_Rect r = {x + col * t->px, y + row * t->px, t->px, t->px};
+                t->rects[t->count++] = r;
+            }
+        }
+    }
+}
+
+static uint16_t read_op(const Cpu *c, uint16_t addr) {
+    return (uint16_t)(c->memory.mem[addr & MEMORY_MASK] << 8 | c->memory.mem[(addr + 1) & MEMORY_MASK]);
+}
+
+void debugger_render(SDL_Renderer *renderer, const Cpu *c) {
+    if (!renderer || !dbg.enabled || !dbg.paused)
+        return;
+
+    static TextBatch t;
+    int w, h;
+    SDL_GetRendererOutputSize(renderer, &w, &h);
+    t.renderer = renderer;
+    t.count = 0;
+    t.px = h / (OVERLAY_LINES * (GLYPH_H + 1) + 2);
+    if (t.px < 1) t.px = 1;
+    int line_h = (GLYPH_H + 1) * t.px;
+    int x = t.px, y = t.px;
+
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 200);
+    SDL_Rect panel = {0, 0, (OVERLAY_COLUMNS * (GLYPH_W + 1) + 1) * t.px, OVERLAY_LINES * line_h + t.px};
+    SDL_RenderFillRect(renderer, &panel);
+
+    char line[64];
+    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+    snprintf(line, sizeof(line), "PC %04X  I %04X  SP %X", c->pc, c->i, c->sp);
+    text_draw(&t, x, y, line);
+    y += line_h;
+    for (int i = 0; i < 16; i += 4, y += line_h) {
+        snprintf(line, sizeof(line), "V%X %02X V%X %02X V%X %02X V%X %02X",
+                 i, c->v[i], i + 1, c->v[i + 1], i + 2, c->v[i + 2], i + 3, c->v[i + 3]);
+        text_draw(&t, x, y, line);
+    }
+    if (dbg.breakpoint)
+        snprintf(line, sizeof(line), "DT %02X  ST %02X  BRK %04X", timer_delay(&c->timer), timer_sound(&c->timer), dbg.breakpoint);
+    else
+        snprintf(line, sizeof(line), "DT %02X  ST %02X  BRK ----", timer_delay(&c->timer), timer_sound(&c->timer));
+    text_draw(&t, x, y, line);
+    y += line_h;
+
+    /* Innermost return address first, two lines of five */
+    for (int l = 0; l < 2; l++, y += line_h) {
+        int len = snprintf(line, sizeof(line), l ? "     " : "STK  ");
+        for (int k = l * 5; k < l * 5 + 5 && k < c->sp && len < (int)sizeof(line) - 5; k++)
+            len += snprintf(line + len, sizeof(line) - (size_t)len, " %04X", c->stack[c->sp - 1 - k]);
+        text_draw(&t, x, y, line);
+    }
+    y += line_h;
+    text_flush(&t);
+
+    uint16_t addr = (uint16_t)(c->pc - DISASM_BEFORE * 2);
+    for (int l = 0; l < DISASM_LINES; l++, y += line_h, addr = (uint16_t)(addr + 2)) {
+        char text[24];
+        uint16_t op = read_op(c, addr);
+        debugger_disassemble(op, text, sizeof(text));
+        char mark = (addr == c->pc) ? '>' : (dbg.breakpoint && addr == dbg.breakpoint) ? '*' : ' ';
+        snprintf(line, sizeof(line), "%c%04X %04X %s", mark, addr, op, text);
+        if (addr == c->pc)
+            SDL_SetRenderDrawColor(renderer, 255, 255, 0, 255);
+        text_draw(&t, x, y, line);
+        text_flush(&t);//the color changes per line
+        SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+    }
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+}
+
+/*
+ * Time travel: periodic checkpoints plus a log of everything the CPU was fed between them
+ * (frame number and keypad, the only inputs, see debugger_record). Going back restores the nearest
+ * older checkpoint and re-executes with the reference interpreter, which lands on exactly the same
+ * states. Checkpoints thin out with age so memory stays bounded: tier t keeps CHECKPOINT_SLOTS of
+ * them spaced CHECKPOINT_INTERVAL * 8^t instructions apart, a checkpoint evicted from a full tier
+ * moves up one tier if it is far enough from the newest one there, otherwise it is dropped.
+ * Worst case replay is one tier 3 gap (512K instructions), a few milliseconds.
+ */
+#define CHECKPOINT_INTERVAL 1000 //instructions between two tier 0 checkpoints
+#define CHECKPOINT_TIERS 4
+#define CHECKPOINT_SLOTS 16 //per tier, 64 x 64KB RAM copies in total
+#define CHECKPOINT_SPACING 8 //tier t+1 spacing / tier t spacing
+#define HISTORY_EVENTS (1u << 19) //entries kept, 12 bytes each (about 2.4 hours at 60 entries per second)
+
+typedef struct {
+    uint32_t instructions;//executed since the previous event
+    uint32_t frames;//frame number - frame number of the previous event
+    uint16_t keys;
+} HistoryEvent;
+
+/* Decoding position in the event log: absolute values of the last applied event */
+typedef struct {
+    uint64_t event;//index of the next event
+    uint64_t instructions;
+    uint64_t frame;
+    uint16_t keys;
+} HistoryCursor;
+
+typedef struct {
+    Cpu cpu;
+    uint8_t *mem;//MEMORY_SIZE bytes
+    HistoryCursor at;//events before it, the first one after it is at.event
+} Checkpoint;
+
+typedef struct {
+    bool enabled;//false after an allocation failure, until the next debugger_init
+    HistoryEvent *events;//ring, absolute index % HISTORY_EVENTS
+    uint64_t event_begin;//oldest event still in the ring
+    HistoryCursor last;//end of the log
+    bool have_last;
+    Checkpoint tiers[CHECKPOINT_TIERS][CHECKPOINT_SLOTS];//oldest first, every tier older than the one below
+    int count[CHECKPOINT_TIERS];
+    uint8_t *spare;//RAM copy of a dropped checkpoint, reused by the next one
+} History;
+
+static History hist = { .enabled = true };
+
+static void history_reset(void) {
+    for (int t = 0; t < CHECKPOINT_TIERS; t++) {
+        for (int k = 0; k < hist.count[t]; k++)
+            free(hist.tiers[t][k].mem);
+        hist.count[t] = 0;
+    }
+    hist.event_begin = 0;
+    hist.last = (HistoryCursor){0};
+    hist.have_last = false;
+    hist.enabled = true;
+}
+
+static void release_mem(uint8_t *mem) {
+    if (hist.spare)
+        free(mem);
+    else
+        hist.spare = mem;
+}
+
+static void take_checkpoint(const Cpu *c) {
+    Checkpoint cp;
+    cp.mem = hist.spare ? hist.spare : malloc(MEMORY_SIZE);
+    hist.spare = NULL;
+    if (!cp.mem) {
+        log_printf("[DBG] Out of memory, time travel disabled\n");
+        hist.enabled = false;
+        return;
+    }
+    cp.cpu = *c;
+    memcpy(cp.mem, c->memory.mem, MEMORY_SIZE);
+    cp.at = hist.last;
+
+    uint64_t spacing = CHECKPOINT_INTERVAL;
+    for (int t = 0; t < CHECKPOINT_TIERS; t++, spacing *= CHECKPOINT_SPACING) {
+        Checkpoint *tier = hist.tiers[t];
+        if (t > 0 && hist.count[t] && cp.cpu.instructions - tier[hist.count[t] - 1].cpu.instructions < spacing)
+            break;//too close to the newest one of this tier
+        if (hist.count[t] < CHECKPOINT_SLOTS) {
+            tier[hist.count[t]++] = cp;
+            return;
+        }
+        Checkpoint oldest = tier[0];
+        memmove(tier, tier + 1, (CHECKPOINT_SLOTS - 1) * sizeof(Checkpoint));
+        tier[CHECKPOINT_SLOTS - 1] = cp;
+        cp = oldest;
+    }
+    release_mem(cp.mem);
+}
+
+static int newest_checkpoint(uint64_t *instructions) {
+    for (int t = 0; t < CHECKPOINT_TIERS; t++)
+        if (hist.count[t]) {
+            *instructions = hist.tiers[t][hist.count[t] - 1].cpu.instructions;
+            return 1;
+        }
+    return 0;
+}
+
+void debugger_record(const Cpu *c, uint64_t frame, uint16_t keys) {
+    if (!hist.enabled)
+        return;
+    if (!hist.events) {
+        hist.events = malloc(HISTORY_EVENTS * sizeof(HistoryEvent));
+        if (!hist.events) {
+            hist.enabled = false;
+            return;
+        }
+    }
+
+    uint64_t newest;
+    if (!newest_checkpoint(&newest) || c->instructions - newest >= CHECKPOINT_INTERVAL)
+        take_checkpoint(c);
+
+    /* Entries with the same frame and keys as the last one change nothing (see cpu_run_frame) */
+    if (hist.have_last && frame == hist.last.frame && keys == hist.last.keys)
+        return;
+    if (hist.last.event - hist.event_begin == HISTORY_EVENTS)
+        hist.event_begin++;//overwrite the oldest, checkpoints before it become unusable
+    hist.events[hist.last.event % HISTORY_EVENTS] = (HistoryEvent){
+        (uint32_t)(c->instructions - hist.last.instructions), (uint32_t)(frame - hist.last.frame), keys
+    };
+    hist.last = (HistoryCursor){ hist.last.event + 1, c->instructions, frame, keys };
+    hist.have_last = true;
+}
+
+/* Checkpoint number 'n' counting from the newest, NULL past the oldest usable one */
+static const Checkpoint *checkpoint_back(int n) {
+    for (int t = 0; t < CHECKPOINT_TIERS; n -= hist.count[t], t++)
+        if (n < hist.count[t]) {
+            const Checkpoint *cp = &hist.tiers[t][hist.count[t] - 1 - n];
+            return cp->at.event >= hist.event_begin ? cp : NULL;
+        }
+    return NULL;
+}
+
+static void restore_checkpoint(Cpu *c, const Checkpoint *cp) {
+    Memory memory = c->memory;
+    *c = cp->cpu;
+    c->memory = memory;
+    memcpy(c->memory.mem, cp->mem, MEMORY_SIZE);
+    memory_mark_dirty(&c->memory, 0, MEMORY_SIZE);//whole RAM changed for snapshot users
+    c->vmemory.dirty_rows = ALL_ROWS;
+    c->vmemory.draw_flag = true;
+}
+
+/* Restore 'cp' and re-execute up to 'target' instructions, applying logged entries exactly where they
+   happened. 'hit' (if not NULL) receives the last position before 'target' with PC at 'watch'.
+   Returns false if the log doesn't get there (CPU left somewhere in between). */
+static bool replay(Cpu *c, const Checkpoint *cp, uint64_t target, uint16_t watch, uint64_t *hit,
+                   HistoryCursor *at) {
+    restore_checkpoint(c, cp);
+    *at = cp->at;
+    uint8_t keypad[16];
+    keypad_from_bits(at->keys, keypad);
+    int64_t spent;
+
+    while (1) {
+        while (at->event < hist.last.event) {
+            const HistoryEvent *e = &hist.events[at->event % HISTORY_EVENTS];
+            if (at->instructions + e->instructions > c->instructions)
+                break;
+            *at = (HistoryCursor){
+                at->event + 1, at->instructions + e->instructions, at->frame + e->frames, e->keys
+            };
+            keypad_from_bits(at->keys, keypad);
+            cpu_run_frame_reference(c, keypad, at->frame, 0, &spent, NULL, NULL);//frame entry, no instruction
+        }
+        if (hit && c->pc == watch && c->instructions < target)
+            *hit = c->instructions;
+        if (c->instructions >= target)
+            return c->instructions == target;
+
+        uint64_t before = c->instructions;
+        cpu_run_frame_reference(c, keypad, at->frame, 1, &spent, NULL, NULL);
+        if (c->instructions == before)
+            return false;//blocked (key wait, display wait) and nothing logged to unblock it
+    }
+}
+
+/* Forget the future: the log now ends at 'at', the CPU state */
+static void truncate_history(const Cpu *c, const HistoryCursor *at) {
+    for (int t = 0; t < CHECKPOINT_TIERS; t++)
+        while (hist.count[t] && hist.tiers[t][hist.count[t] - 1].cpu.instructions > c->instructions)
+            release_mem(hist.tiers[t][--hist.count[t]].mem);
+    hist.last = *at;
+    hist.have_last = true;//the CPU already saw this frame and keys, the next entry repeats them
+}
+
+/* Travel to 'target' from the newest checkpoint at or before it, current state kept on failure */
+static bool travel(Cpu *c, uint64_t target) {
+    const Checkpoint *cp = NULL;
+    for (int n = 0; (cp = checkpoint_back(n)) && cp->cpu.instructions > target; n++)
+        ;
+    if (!cp)
+        return false;
+
+    Checkpoint now = { *c, malloc(MEMORY_SIZE), hist.last };
+    if (!now.mem)
+        return false;
+    memcpy(now.mem, c->memory.mem, MEMORY_SIZE);
+
+    HistoryCursor at;
+    bool ok = replay(c, cp, target, 0, NULL, &at);
+    if (ok)
+        truncate_history(c, &at);
+    else
+        restore_checkpoint(c, &now);
+    free(now.mem);
+    return ok;
+}
+
+bool debugger_step_back(Cpu *c) {
+    if (!dbg.enabled)
+        return false;
+    if (c->instructions == 0 || !travel(c, c->instructions - 1)) {
+        log_printf("[DBG] No history to step back into\n");
+        return false;
+    }
+    dbg.paused = true;
+    log_printf("\n[DBG] STEP BACK @ PC=0x%03X (instruction %llu)\n", c->pc, (unsigned long long)c->instructions);
+    debugger_print_state(c);
+    return true;
+}
+
+bool debugger_reverse_continue(Cpu *c) {
+    if (!dbg.enabled)
+        return false;
+
+    Checkpoint now = { *c, malloc(MEMORY_SIZE), hist.last };
+    if (!now.mem)
+        return false;
+    memcpy(now.mem, c->memory.mem, MEMORY_SIZE);
+
+    /* Search backwards one checkpoint gap at a time, replaying each gap once to find the hits in it.
+       Without a breakpoint (or hit) the target is the oldest reachable point. */
+    uint64_t end = c->instructions;
+    uint64_t target = end;
+    bool found = false;
+    const Checkpoint *cp;
+    for (int n = 0; (cp = checkpoint_back(n)) != NULL; n++) {
+        if (cp->cpu.instructions >= end)
+            continue;
+        if (dbg.breakpoint) {
+            HistoryCursor at;
+            uint64_t hit = end;
+            if (!replay(c, cp, end, dbg.breakpoint, &hit, &at))
+                break;
+            if (hit < end) {
+                target = hit;
+                found = true;
+                break;
+            }
+        }
+        target = end = cp->cpu.instructions;
+    }
+
+    HistoryCursor at;
+    bool ok = false;
+    if (target < now.cpu.instructions) {
+        for (int n = 0; (cp = checkpoint_back(n)) && cp->cpu.instructions > target; n++)
+            ;
+        ok = cp && replay(c, cp, target, 0, NULL, &at);
+    }
+    if (ok) {
+        truncate_history(c, &at);
+        dbg.paused = true;
+        if (found)
+            log_printf("\n[DBG] REVERSE BREAK @ PC=0x%03X (instruction %llu)\n", c->pc, (unsigned long long)c->instructions);
+        else
+            log_printf("\n[DBG] Reached the start of the history @ PC=0x%03X (instruction %llu)\n", c->pc,
+                       (unsigned long long)c->instructions);
+        debugger_print_state(c);
+    } else {
+        restore_checkpoint(c, &now);
+        log_printf("[DBG] No history to run back into\n");
+    }
+    free(now.mem);
+    return ok;
+}
+
+void debugger_free(void) {
+    history_reset();
+    free(hist.events);
+    free(hist.spare);
+    hist.events = NULL;
+    hist.spare = NULL;
+}
@@ -18,6 +18,23 @@ extern Debugger dbg;
 void debugger_init(void);
 void debugger_handle_event(char key, Cpu *c);
 bool debugger_should_execute(Cpu *c);
-void debugger_render(SDL_Renderer *renderer);
+/* Print registers and timers through the logger (log.h) */
+void debugger_print_state(Cpu *c);
+/* One instruction as text, e.g. "DRW V0, V1, 5" (or "???") */
+void debugger_disassemble(uint16_t op, char *out, size_t len);
+/* While paused: registers, stack, timers and the disassembly around PC over the current frame
+   (call before SDL_RenderPresent, once per frame). Draws nothing while running. */
+void debugger_render(SDL_Renderer *renderer, const Cpu *c);
+
+/* Time travel. Call debugger_record before every cpu_run_frame of the real machine with its arguments
+   (keys as keypad_to_bits), it keeps checkpoints and the input log in bounded memory.
+   Step back: the state one instruction earlier. Reverse continue: the last earlier instruction at the
+   breakpoint, or the oldest reachable state without one. Both pause, return false (state untouched)
+   if the history doesn't reach that far, and leave the frame number the CPU is in at c->timer.frame.
+   Going back discards the future, running again records a new one. */
+void debugger_record(const Cpu *c, uint64_t frame, uint16_t keys);
+bool debugger_step_back(Cpu *c);
+bool debugger_reverse_continue(Cpu *c);
+void debugger_free(void);
 
 #endif
@@ -1,6 +1,12 @@
 #include "display.h"
 #include <stdio.h>
 #include <string.h>
+#include <stdlib.h>
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#include <immintrin.h>
+#define HAVE_SSSE3_COMPOSITE 1
+#endif
 
 static const ColorTheme THEME_RED   = {255, 180, 40, 120, 8, 0};
 static const ColorTheme THEME_GREEN = {55, 255, 40, 30, 80, 0};
@@ -10,6 +16,87 @@ static const ColorTheme THEME_BGREEN= {0, 255, 0, 0, 0, 0};
 static const ColorTheme THEME_BBLUE = {0, 0, 255, 0, 0, 0};
 static const ColorTheme THEME_BWHITE= {255, 255, 255, 0, 0, 0};
 
+/* XO-CHIP colors for plane combinations 2..15, 0 and 1 come from the theme (same defaults as Octo) */
+static const uint32_t PLANE_COLORS[PALETTE_SIZE] = {
+    0, 0, 0xFFAAAAAA, 0xFF555555,
+    0xFFFF0000, 0xFF00FF00, 0xFF0000FF, 0xFFFFFF00,
+    0xFF880000, 0xFF008800, 0xFF000088, 0xFF888800,
+    0xFFFF00FF, 0xFF00FFFF, 0xFF880088, 0xFF008888
+};
+
+static uint32_t argb(uint8_t r, uint8_t g, uint8_t b) {
+    return 0xFF000000u | ((uint32_t)r << 16) | ((uint32_t)g << 8) | (uint32_t)b;
+}
+
+void display_palette_from_theme(ColorTheme theme, uint32_t palette[PALETTE_SIZE]) {
+    memcpy(palette, PLANE_COLORS, sizeof(PLANE_COLORS));
+    palette[0] = argb(theme.sr, theme.sg, theme.sb);//pixel OFF
+    palette[1] = argb(theme.pr, theme.pg, theme.pb);//pixel ON in plane 0
+}
+
+/* Composite one frame: every framebuffer byte is a plane bitmask, so compositing the
+   planes into the texture is a 16 entry palette lookup per pixel. */
+static void composite_scalar(const uint8_t *src, uint32_t *dst, int dst_pitch, const uint32_t *palette) {
+    for (size_t y = 0; y < SCREEN_HEIGHT; ++y) {
+        const uint8_t *s = src + y * SCREEN_WIDTH;
+        uint32_t *d = (uint32_t *)((uint8_t *)dst + y * (size_t)dst_pitch);
+        for (size_t x = 0; x < SCREEN_WIDTH; ++x)
+            d[x] = palette[s[x] & (PALETTE_SIZE - 1)];
+    }
+}
+
+#ifdef HAVE_SSSE3_COMPOSITE
+/* Same lookup, 16 pixels at a time: the palette is split in four byte tables (B,G,R,A)
+   so PSHUFB does the lookup for every channel, then the channels are interleaved back
+   into ARGB8888 pixels. */
+__attribute__((target("ssse3")))
+static void composite_ssse3(const uint8_t *src, uint32_t *dst, int dst_pitch, const uint32_t *palette) {
+    uint8_t ch[4][PALETTE_SIZE];
+    for (size_t i = 0; i < PALETTE_SIZE; i++) {
+        ch[0][i] = (uint8_t)(palette[i]);       //B
+        ch[1][i] = (uint8_t)(palette[i] >> 8);  //G
+        ch[2][i] = (uint8_t)(palette[i] >> 16); //R
+        ch[3][i] = (uint8_t)(palette[i] >> 24); //A
+    }
+    const __m128i tb = _mm_loadu_si128((const __m128i *)ch[0]);
+    const __m128i tg = _mm_loadu_si128((const __m128i *)ch[1]);
+    const __m128i tr = _mm_loadu_si128((const __m128i *)ch[2]);
+    const __m128i ta = _mm_loadu_si128((const __m128i *)ch[3]);
+    const __m128i low = _mm_set1_epi8(PALETTE_SIZE - 1);
+
+    for (size_t y = 0; y < SCREEN_HEIGHT; ++y) {
+        const uint8_t *s = src + y * SCREEN_WIDTH;
+        __m128i *d = (__m128i *)((uint8_t *)dst + y * (size_t)dst_pitch);
+        for (size_t x = 0; x < SCREEN_WIDTH; x += 16) {
+            __m128i v = _mm_and_si128(_mm_loadu_si128((const __m128i *)(s + x)), low);
+            __m128i b = _mm_shuffle_epi8(tb, v);
+            __m128i g = _mm_shuffle_epi8(tg, v);
+            __m128i r = _mm_shuffle_epi8(tr, v);
+            __m128i a = _mm_shuffle_epi8(ta, v);
+            __m128i bg_lo = _mm_unpacklo_epi8(b, g), bg_hi = _mm_unpackhi_epi8(b, g);
+            __m128i ra_lo = _mm_unpacklo_epi8(r, a), ra_hi = _mm_unpackhi_epi8(r, a);
+            _mm_storeu_si128(d++, _mm_unpacklo_epi16(bg_lo, ra_lo));
+            _mm_storeu_si128(d++, _mm_unpackhi_epi16(bg_lo, ra_lo));
+            _mm_storeu_si128(d++, _mm_unpacklo_epi16(bg_hi, ra_hi));
+            _mm_storeu_si128(d++, _mm_unpackhi_epi16(bg_hi, ra_hi));
+        }
+    }
+}
+#endif
+
+void display_composite(const uint8_t *src, uint32_t *dst, int dst_pitch, const uint32_t *palette) {
+#ifdef HAVE_SSSE3_COMPOSITE
+    static int has_ssse3 = -1;
+    if (has_ssse3 < 0)
+        has_ssse3 = __builtin_cpu_supports("ssse3") ? 1 : 0;
+    if (has_ssse3) {
+        composite_ssse3(src, dst, dst_pitch, palette);
+        return;
+    }
+#endif
+    composite_scalar(src, dst, dst_pitch, palette);
+}
+
 int theme_from_str(const char *s, ColorTheme *out_theme) {
     if (!s || !out_theme) return 1;
     if (strcmp(s, "r") == 0)      *out_theme = THEME_RED;
@@ -59,6 +146,16 @@ int display_init(DisplayHandler *dh, uint32_t scale, ColorTheme theme) {
         return 1;
     }
 
+    /* Framebuffer texture, composited on the CPU and scaled by the renderer */
+    SDL_Texture *tex = SDL_CreateTexture(render, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING,
+                                         SCREEN_WIDTH, SCREEN_HEIGHT);
+    if (!tex) {
+        fprintf(stderr, "SDL_CreateTexture failed: %s\n", SDL_GetError());
+        SDL_DestroyRenderer(render);
+        SDL_DestroyWindow(win);
+        return 1;
+    }
+
     /* Initialize canvas background with secondary color*/
     SDL_SetRenderDrawColor(render, theme.sr, theme.sg, theme.sb, 255);
     SDL_RenderClear(render);//clear screen
@@ -67,6 +164,7 @@ int display_init(DisplayHandler *dh, uint32_t scale, ColorTheme theme) {
     /* Fill handler */
     dh->window = win;
     dh->renderer = render;
+    dh->texture = tex;
     dh->primary_color.r = theme.pr;
     dh->primary_color.g = theme.pg;
     dh->primary_color.b = theme.pb;
@@ -78,12 +176,64 @@ int display_init(DisplayHandler *dh, uint32_t scale, ColorTheme theme) {
     dh->secondary_color.a = 255;
     dh->scale = scale;
 
+    display_palette_from_theme(theme, dh->palette);
+
+    return 0;
+}
+
+int display_set_effects(DisplayHandler *dh, uint32_t phosphor, bool crt) {
+    if (!dh || !dh->renderer) return 1;
+    if (phosphor == 0 && !crt) return 0;
+
+    Scaler *s = malloc(sizeof(*s));
+    if (!s || scaler_init(s, dh->scale, phosphor, crt) != 0) {
+        fprintf(stderr, "Display effects: out of memory\n");
+        free(s);
+        return 1;
+    }
+    if (crt) {//the scaler writes every window pixel, the renderer no longer scales
+        SDL_Texture *tex = SDL_CreateTexture(dh->renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING,
+                                             (int)scaler_width(s), (int)scaler_height(s));
+        if (!tex) {
+            fprintf(stderr, "SDL_CreateTexture failed: %s\n", SDL_GetError());
+            scaler_free(s);
+            free(s);
+            return 1;
+        }
+        SDL_DestroyTexture(dh->texture);
+        dh->texture = tex;
+    }
+    dh->scaler = s;
     return 0;
 }
 
+bool display_animating(const DisplayHandler *dh) {
+    return dh->scaler && dh->scaler->keep;
+}
+
 int display_draw(DisplayHandler *dh) {
+    if (display_render(dh) != 0) return 1;
+    display_present(dh);
+    return 0;
+}
+
+int display_render(DisplayHandler *dh) {
     if (!dh || !dh->renderer || !dh->draw_pixels) return 1;
 
+    void *pixels;
+    int pitch;
+    if (SDL_LockTexture(dh->texture, NULL, &pixels, &pitch) != 0) {
+        fprintf(stderr, "SDL_LockTexture failed: %s\n", SDL_GetError());
+        return 1;
+    }
+    if (dh->scaler) {
+        display_composite(dh->draw_pixels, dh->scaler->frame, SCREEN_WIDTH * sizeof(uint32_t), dh->palette);
+        scaler_run(dh->scaler, (uint32_t *)pixels, pitch);
+    } else {
+        display_composite(dh->draw_pixels, (uint32_t *)pixels, pitch, dh->palette);
+    }
+    SDL_UnlockTexture(dh->texture);
+
     /* Clear screen with secondary color */
     SDL_SetRenderDrawColor(dh->renderer,
                            dh->secondary_color.r,
@@ -92,33 +242,26 @@ int display_draw(DisplayHandler *dh) {
                            dh->secondary_color.a);
     SDL_RenderClear(dh->renderer);
 
-    /* Set primary color for pixels */
-    SDL_SetRenderDrawColor(dh->renderer,
-                           dh->primary_color.r,
-                           dh->primary_color.g,
-                           dh->primary_color.b,
-                           dh->primary_color.a);
-
-    /* Draw each set pixel as a filled rectangle of size scale x scale */
-    for (size_t y = 0; y < SCREEN_HEIGHT; ++y) {
-        for (size_t x = 0; x < SCREEN_WIDTH; ++x) {
-            if (dh->draw_pixels[idx(x, y)] != 1) continue;
-            SDL_Rect r;
-            //pixels are small, host window is large, use scale=10 so (3,2)->(30,20)
-            r.x = (int)(x * (size_t)dh->scale);
-            r.y = (int)(y * (size_t)dh->scale);
-            r.w = (int)dh->scale;
-            r.h = (int)dh->scale;
-            SDL_RenderFillRect(dh->renderer, &r);
-        }
-    }
+    //pixels are small, host window is large, the renderer scales 64x32 up to the window size
+    SDL_RenderCopy(dh->renderer, dh->texture, NULL, NULL);
+    return 0;
+}
 
+void display_present(DisplayHandler *dh) {
     SDL_RenderPresent(dh->renderer);
-    return 0;
 }
 
 void display_shutdown(DisplayHandler *dh) {
     if (!dh) return;
+    if (dh->scaler) {
+        scaler_free(dh->scaler);
+        free(dh->scaler);
+        dh->scaler = NULL;
+    }
+    if (dh->texture) {
+        SDL_DestroyTexture(dh->texture);
+        dh->texture = NULL;
+    }
     if (dh->renderer) {
         SDL_DestroyRenderer(dh->renderer);
         dh->renderer = NULL;
@@ -2,9 +2,11 @@
 #define DISPLAY_H
 
 #include <stdint.h>
+#include <stdbool.h>
 //#include <SDL2/SDL.h>
 #include "SDL.h"
 #include "vmemory.h"
+#include "scaler.h"
 
 /* ColorTheme: primary RGB followed by secondary RGB */
 typedef struct {
@@ -26,17 +28,28 @@ int theme_from_str(const char *s, ColorTheme *out_theme);
  */
 int scale_from_str(const char *s, uint32_t *out_scale);
 
+#define PALETTE_SIZE (1u << PLANE_COUNT) //one color per combination of XO-CHIP planes
+
 /* DisplayHandler type: holds window/renderer and colors/scale */
 typedef struct {
     SDL_Window  *window;
     SDL_Renderer* renderer;
+    SDL_Texture *texture; //64x32 streaming texture, scaled to the window by the renderer
     SDL_Color primary_color;
     SDL_Color secondary_color;
+    uint32_t palette[PALETTE_SIZE]; //ARGB8888 color for each plane bitmask value
     uint32_t scale;
     uint8_t *draw_pixels;
+    Scaler *scaler; //phosphor/CRT stage, NULL = palette lookup straight into the texture
     
 } DisplayHandler;
 
+/* ARGB8888 color for every plane bitmask value (0 = secondary, 1 = primary, others XO-CHIP colors) */
+void display_palette_from_theme(ColorTheme theme, uint32_t palette[PALETTE_SIZE]);
+
+/* Palette lookup of one 64x32 framebuffer into ARGB8888 pixels, 'dst_pitch' bytes per row (SSSE3 when available) */
+void display_composite(const uint8_t *src, uint32_t *dst, int dst_pitch, const uint32_t *palette);
+
 /* Initialize display handler.
  * - scale: pixel scaling factor
  * - theme: ColorTheme struct
@@ -44,12 +57,27 @@ typedef struct {
  */
 int display_init(DisplayHandler *dh, uint32_t scale, ColorTheme theme);
 
+/* Enable the CPU post-processing stage (scaler.h) after display_init: phosphor persistence in
+ * percent (0 = off) and/or the CRT mask, which makes the texture window-sized.
+ * Returns 0 on success, non-zero on error (the display keeps working without effects).
+ */
+int display_set_effects(DisplayHandler *dh, uint32_t phosphor, bool crt);
+
+/* True if the picture keeps changing without new frames (phosphor fading), so every frame must be drawn */
+bool display_animating(const DisplayHandler *dh);
+
 /* Draw framebuffer.
- * - buffer: pointer to SCREEN_WIDTH * SCREEN_HEIGHT bytes (0 or 1)
+ * - buffer: pointer to SCREEN_WIDTH * SCREEN_HEIGHT bytes (plane bitmask, 0 or 1 for CHIP-8)
  * Returns 0 on success, non-zero on error.
  */
 int display_draw(DisplayHandler *dh);
 
+/* display_draw in two steps, so overlays can be drawn on top of the frame before it is shown.
+ * display_render returns 0 on success, non-zero on error.
+ */
+int display_render(DisplayHandler *dh);
+void display_present(DisplayHandler *dh);
+
 /* Shutdown and free display resources (window/renderer). Safe to call even if init failed. */
 void display_shutdown(DisplayHandler *dh);
 
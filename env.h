@@ -0,0 +1,73 @@
+#ifndef ENV_H
+#define ENV_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Shared memory environment for training agents against CHIP-8 games (chip8_env, Linux only).
+ * The server hosts 'count' instances in one POSIX shared memory segment (/dev/shm/<name>).
+ * It writes observations straight into the segment and the client reads them in place,
+ * nothing is serialized or copied per step. After the EnvShared header, at the given offsets:
+ *   actions  u16[count]                   keypad bits held during the next step     (client)
+ *   reset    u8[count]                    non-zero: restart this instance on ENV_RESET (client)
+ *   frames   u8[count][ENV_FRAME_BYTES]   screen, 1 bit per pixel, MSB first, rows top down (server)
+ *   rewards  i32[count]                   reward of the last step                   (server)
+ *   dones    u8[count]                    episode over, stays set until reset       (server)
+ *
+ * A command: the client fills the arrays and 'op', increments 'request' and wakes it (futex).
+ * The server sets 'response' to the same value once every instance is done and wakes it.
+ * env_call below does exactly that for C clients.
+ */
+#define ENV_MAGIC 0x38504843u //"CHP8", written last by the server: the segment is ready
+#define ENV_VERSION 1
+#define ENV_FRAME_BYTES (64 * 32 / 8)
+
+typedef enum {
+    ENV_STEP = 1,//run frames_per_step frames on every instance with its action
+    ENV_RESET,//restart the instances flagged in reset[], their observations are refreshed
+    ENV_QUIT//server unlinks the segment and exits
+} EnvOp;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;//instances
+    uint32_t frames_per_step;
+    uint32_t actions_offset;//byte offsets from the start of the segment
+    uint32_t reset_offset;
+    uint32_t frames_offset;
+    uint32_t rewards_offset;
+    uint32_t dones_offset;
+    uint32_t size;//whole segment
+    uint32_t op;//EnvOp of the pending request
+    uint32_t request;//futex, incremented by the client
+    uint32_t response;//futex, set to 'request' by the server when the command completed
+} EnvShared;
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/* Not FUTEX_PRIVATE_FLAG, the words are shared between processes */
+static inline void env_futex_wait(uint32_t *word, uint32_t value) {
+    syscall(SYS_futex, word, FUTEX_WAIT, value, NULL, NULL, 0);
+}
+
+static inline void env_futex_wake(uint32_t *word) {
+    syscall(SYS_futex, word, FUTEX_WAKE, 0x7FFFFFFF, NULL, NULL, 0);
+}
+
+/* Client side: run one command and wait until the server has finished it */
+static inline void env_call(EnvShared *env, EnvOp op) {
+    env->op = op;
+    uint32_t req = __atomic_add_fetch(&env->request, 1, __ATOMIC_RELEASE);
+    env_futex_wake(&env->request);
+    uint32_t seen;
+    while ((seen = __atomic_load_n(&env->response, __ATOMIC_ACQUIRE)) != req)
+        env_futex_wait(&env->response, seen);
+}
+#endif
+
+#endif /* ENV_H */
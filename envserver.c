@@ -0,0 +1,315 @@
+/*
+ * envserver.c - chip8_env, shared memory environment server for agent training (see env.h).
+ * Built on the SDL-free core (chip8_core.h) only:
+ *   make env
+ *   ./chip8_env <shm-name> <ROM> [-n <instances>] [-j <threads>] [-k <frames per step>]
+ *               [-q <profile>] [--reward [+|-]<addr>]... [--done <addr>[=<value>]]
+ * Reward of a step: the change of the RAM bytes at the --reward addresses (negated with -),
+ * e.g. the player's and the opponent's score. Done: the byte at --done is non-zero (or == value).
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "env.h"
+#include "chip8_core.h"
+#include "memory.h"
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define ENV_MAX_REWARDS 8
+#define ENV_MAX_THREADS 64
+#define ENV_MAX_INSTANCES (1u << 20)//keeps the segment layout within 32 bit offsets
+#define ENV_MAX_FRAMES_PER_STEP 3600
+
+typedef struct {
+    uint16_t addr;
+    int sign;//+1 or -1
+} RewardTerm;
+
+typedef struct {
+    EnvShared *sh;
+    Chip8 **inst;
+    uint8_t (*score)[ENV_MAX_REWARDS];//reward bytes after the previous step, per instance
+    RewardTerm rewards[ENV_MAX_REWARDS];
+    int reward_count;
+    int done_addr;//-1 = never done
+    int done_value;//-1 = any non-zero value
+    uint32_t pending;//workers still busy with the current command
+    uint32_t workers;
+} Server;
+
+typedef struct {
+    Server *srv;
+    uint32_t first, end;//instances [first, end)
+} Worker;
+
+static uint8_t *seg(const Server *srv, uint32_t offset) {
+    return (uint8_t *)srv->sh + offset;
+}
+
+/* Observation of instance i, written in place into the segment */
+static void observe(Server *srv, uint32_t i, int32_t reward) {
+    const uint8_t *fb = chip8_framebuffer(srv->inst[i]);
+    const uint8_t *mem = chip8_memory(srv->inst[i]);
+    uint8_t *out = seg(srv, srv->sh->frames_offset) + (size_t)i * ENV_FRAME_BYTES;
+
+    for (size_t b = 0; b < ENV_FRAME_BYTES; b++, fb += 8) {
+        uint8_t v = 0;
+        for (int k = 0; k < 8; k++)
+            v = (uint8_t)((v << 1) | (fb[k] != 0));
+        out[b] = v;
+    }
+    ((int32_t *)seg(srv, srv->sh->rewards_offset))[i] = reward;
+    if (srv->done_addr >= 0) {
+        uint8_t d = mem[srv->done_addr];
+        if (srv->done_value < 0 ? d != 0 : d == srv->done_value)
+            seg(srv, srv->sh->dones_offset)[i] = 1;
+    }
+}
+
+static int32_t collect_reward(Server *srv, uint32_t i) {
+    const uint8_t *mem = chip8_memory(srv->inst[i]);
+    int32_t reward = 0;
+    for (int r = 0; r < srv->reward_count; r++) {
+        uint8_t now = mem[srv->rewards[r].addr];
+        reward += srv->rewards[r].sign * ((int32_t)now - (int32_t)srv->score[i][r]);
+        srv->score[i][r] = now;
+    }
+    return reward;
+}
+
+static void reset_instance(Server *srv, uint32_t i) {
+    if (chip8_reset(srv->inst[i]) != 0) {//out of memory: the old game stays, reported as over
+        fprintf(stderr, "[env] instance %u: reset failed, out of memory\n", i);
+        seg(srv, srv->sh->dones_offset)[i] = 1;
+        observe(srv, i, 0);
+        return;
+    }
+    seg(srv, srv->sh->dones_offset)[i] = 0;
+    collect_reward(srv, i);//scores of the fresh game are the new baseline
+    observe(srv, i, 0);
+}
+
+static void *worker_main(void *arg) {
+    Worker *w = arg;
+    Server *srv = w->srv;
+    EnvShared *sh = srv->sh;
+    uint32_t seen = 0;
+
+    for (;;) {
+        uint32_t req;
+        while ((req = __atomic_load_n(&sh->request, __ATOMIC_ACQUIRE)) == seen)
+            env_futex_wait(&sh->request, seen);
+        seen = req;
+
+        uint32_t op = sh->op;
+        const uint16_t *actions = (const uint16_t *)seg(srv, sh->actions_offset);
+        const uint8_t *reset = seg(srv, sh->reset_offset);
+        for (uint32_t i = w->first; i < w->end && op != ENV_QUIT; i++) {
+            if (op == ENV_STEP) {
+                chip8_step_frames(srv->inst[i], sh->frames_per_step, actions[i]);
+                observe(srv, i, collect_reward(srv, i));
+            } else if (op == ENV_RESET && reset[i]) {
+                reset_instance(srv, i);
+            }
+        }
+
+        /* The last worker to finish answers, nobody can be in the next command before that */
+        if (__atomic_sub_fetch(&srv->pending, 1, __ATOMIC_ACQ_REL) == 0) {
+            srv->pending = srv->workers;
+            __atomic_store_n(&sh->response, seen, __ATOMIC_RELEASE);
+            env_futex_wake(&sh->response);
+        }
+        if (op == ENV_QUIT)
+            return NULL;
+    }
+}
+
+static int parse_addr(const char *s, uint16_t *out) {
+    char *end = NULL;
+    unsigned long v = strtoul(s, &end, 0);
+    if (end == s || v >= MEMORY_SIZE)
+        return 1;
+    *out = (uint16_t)v;
+    return *end == '\0' || *end == '=' ? 0 : 1;
+}
+
+/* Decimal count in [min, max], the whole string */
+static int parse_count(const char *s, uint32_t min, uint32_t max, uint32_t *out) {
+    char *end = NULL;
+    unsigned long v = strtoul(s, &end, 10);
+    if (end == s || *end != '\0' || *s == '-' || v < min || v > max)
+        return 1;
+    *out = (uint32_t)v;
+    return 0;
+}
+
+static int usage(void) {
+    fprintf(stderr, "Usage: chip8_env <shm-name> <ROM> [-n <instances>] [-j <threads>] [-k <frames per step>]\n"
+                    "                 [-q <profile>] [--reward [+|-]<addr>]... [--done <addr>[=<value>]]\n");
+    return 1;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 3)
+        return usage();
+    const char *name = argv[1];
+    uint32_t count = 1, threads = 0, frames_per_step = 4;
+    Chip8Options options = {DEFAULT_QUIRK_PROFILE, TIMING_INSTRUCTIONS, 0, 0};
+    Server srv;
+    memset(&srv, 0, sizeof(srv));
+    srv.done_addr = -1;
+    srv.done_value = -1;
+
+    for (int i = 3; i < argc; i++) {
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!value)
+            return usage();
+        if (!strcmp(argv[i], "-n")) {
+            if (parse_count(value, 1, ENV_MAX_INSTANCES, &count) != 0)
+                return usage();
+        } else if (!strcmp(argv[i], "-j")) {
+            if (parse_count(value, 0, ENV_MAX_THREADS, &threads) != 0)//0 = one per core
+                return usage();
+        } else if (!strcmp(argv[i], "-k")) {
+            if (parse_count(value, 1, ENV_MAX_FRAMES_PER_STEP, &frames_per_step) != 0)
+                return usage();
+        } else if (!strcmp(argv[i], "-q")) {
+            if (quirk_profile_from_str(value, &options.profile) != 0)
+                return 1;
+        } else if (!strcmp(argv[i], "--reward")) {
+            RewardTerm t = {0, 1};
+            if (*value == '+' || *value == '-')
+                t.sign = *value++ == '-' ? -1 : 1;
+            if (srv.reward_count == ENV_MAX_REWARDS || parse_addr(value, &t.addr) != 0)
+                return usage();
+            srv.rewards[srv.reward_count++] = t;
+        } else if (!strcmp(argv[i], "--done")) {
+            uint16_t addr;
+            if (parse_addr(value, &addr) != 0)
+                return usage();
+            srv.done_addr = addr;
+            const char *eq = strchr(value, '=');
+            if (eq) {
+                char *end = NULL;
+                unsigned long v = strtoul(eq + 1, &end, 0);
+                if (end == eq + 1 || *end != '\0' || v > 0xFF)
+                    return usage();
+                srv.done_value = (int)v;
+            }
+        } else {
+            return usage();
+        }
+        i++;
+    }
+    if (threads == 0) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cores > 0 ? (uint32_t)cores : 1;
+    }
+    if (threads > count) threads = count;
+    if (threads > ENV_MAX_THREADS) threads = ENV_MAX_THREADS;
+
+    size_t rom_size = 0;
+    uint8_t *rom = memory_read_rom(argv[2], &rom_size);
+    if (!rom) {
+        fprintf(stderr, "Failed to read ROM: %s\n", argv[2]);
+        return 1;
+    }
+
+    /* Layout, every array 8 byte aligned */
+    uint32_t off = (sizeof(EnvShared) + 7) & ~7u;
+    uint32_t actions = off;  off += (count * sizeof(uint16_t) + 7) & ~7u;
+    uint32_t reset = off;    off += (count + 7) & ~7u;
+    uint32_t frames = off;   off += count * ENV_FRAME_BYTES;
+    uint32_t rewards = off;  off += count * sizeof(int32_t);
+    uint32_t dones = off;    off += count;
+
+    int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        perror("[env] shm_open");
+        free(rom);
+        return 1;
+    }
+    if (ftruncate(fd, off) != 0) {
+        perror("[env] ftruncate");
+        close(fd);
+        shm_unlink(name);
+        free(rom);
+        return 1;
+    }
+    EnvShared *sh = mmap(NULL, off, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (sh == MAP_FAILED) {
+        perror("[env] mmap");
+        shm_unlink(name);
+        free(rom);
+        return 1;
+    }
+    sh->version = ENV_VERSION;
+    sh->count = count;
+    sh->frames_per_step = frames_per_step;
+    sh->actions_offset = actions;
+    sh->reset_offset = reset;
+    sh->frames_offset = frames;
+    sh->rewards_offset = rewards;
+    sh->dones_offset = dones;
+    sh->size = off;
+
+    srv.sh = sh;
+    srv.inst = calloc(count, sizeof(*srv.inst));
+    srv.score = calloc(count, sizeof(*srv.score));
+    int rc = 0;
+    if (!srv.inst || !srv.score) {
+        fprintf(stderr, "[env] out of memory\n");
+        rc = 1;
+    }
+    for (uint32_t i = 0; rc == 0 && i < count; i++) {
+        srv.inst[i] = chip8_create(rom, rom_size, &options);
+        if (!srv.inst[i]) {
+            fprintf(stderr, "[env] instance %u: out of memory or ROM too large\n", i);
+            rc = 1;
+        } else {
+            reset_instance(&srv, i);
+        }
+    }
+    free(rom);
+    if (rc != 0)
+        goto cleanup;
+
+    pthread_t tid[ENV_MAX_THREADS];
+    Worker workers[ENV_MAX_THREADS];
+    srv.workers = srv.pending = threads;
+    __atomic_store_n(&sh->magic, ENV_MAGIC, __ATOMIC_RELEASE);//ready for clients
+    fprintf(stderr, "[env] /%s: %u instances, %u threads, %u frames per step\n", name, count, threads, frames_per_step);
+
+    for (uint32_t t = 0; t < threads; t++) {
+        workers[t].srv = &srv;
+        workers[t].first = (uint32_t)((uint64_t)count * t / threads);
+        workers[t].end = (uint32_t)((uint64_t)count * (t + 1) / threads);
+        pthread_create(&tid[t], NULL, worker_main, &workers[t]);
+    }
+    for (uint32_t t = 0; t < threads; t++)
+        pthread_join(tid[t], NULL);
+
+cleanup:
+    shm_unlink(name);
+    munmap(sh, off);
+    for (uint32_t i = 0; srv.inst && i < count; i++)
+        chip8_destroy(srv.inst[i]);//NULL for instances never created
+    free(srv.inst);
+    free(srv.score);
+    return rc;
+}
+#else
+int main(void) {
+    fprintf(stderr, "chip8_env needs Linux (POSIX shared memory and futexes)\n");
+    return 1;
+}
+#endif
@@ -0,0 +1,115 @@
+/*
+ * fuzz.c - libFuzzer / AFL target for the CPU core (no SDL needed at link time)
+ *
+ * Input layout:
+ *   byte 0      flags: bits 0-1 quirk profile, bit 6 VIP timing, bit 7 keypad script follows
+ *   [byte 1     number of script frames k, then k little endian 16 bit keypad masks, one per frame]
+ *   rest        ROM, loaded at 0x200
+ *
+ * Each input runs FUZZ_FRAMES frames of at most FUZZ_FRAME_BUDGET instructions. The machine is
+ * reset from a pristine snapshot, only the RAM touched by the previous input is copied back.
+ *
+ *   make fuzz                       libFuzzer + ASan/UBSan, guarded memory
+ *   ./chip8_fuzz corpus/ -jobs=8
+ *   make fuzz-afl                   standalone binary, runs each file given (or stdin) once
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cpu.h"
+#include "memory.h"
+#include "timer.h"
+#include "vmemory.h"
+#include "snapshot.h"
+
+#define FUZZ_FRAMES 16
+#define FUZZ_FRAME_BUDGET 64 //instructions (or ~VIP cycles / 50) per frame
+
+#define FLAG_VIP 0x40
+#define FLAG_SCRIPT 0x80
+
+static Cpu cpu;
+static Snapshot pristine;
+
+static void fuzz_init(void) {
+    Memory mem;
+    Timer timer;
+    VMemory vmemory;
+
+    if (memory_new(&mem, NULL, 0) != 0 || snapshot_init(&pristine) != 0)
+        abort();
+    timer_init(&timer);
+    vmemory_init(&vmemory);
+    cpu_new(&cpu, &mem, &timer, &vmemory);
+    snapshot_save(&pristine, &cpu);//font loaded, empty program area
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    if (!pristine.mem)
+        fuzz_init();
+    if (size < 1)
+        return 0;
+
+    uint8_t flags = data[0];
+    data++, size--;
+
+    const uint8_t *script = NULL;
+    size_t script_frames = 0;
+    if ((flags & FLAG_SCRIPT) && size >= 1) {
+        script_frames = data[0];
+        data++, size--;
+        if (script_frames * 2 > size)
+            script_frames = size / 2;
+        script = data;
+        data += script_frames * 2;
+        size -= script_frames * 2;
+    }
+    if (size > MEMORY_SIZE - PROGRAM_START)
+        size = MEMORY_SIZE - PROGRAM_START;
+
+    snapshot_restore(&pristine, &cpu);
+    memcpy(cpu.memory.mem + PROGRAM_START, data, size);
+    memory_mark_dirty(&cpu.memory, PROGRAM_START, (uint32_t)(PROGRAM_START + size));//undone by the next restore
+    cpu_set_profile(&cpu, (QuirkProfile)((flags & 0x3) % QUIRKS_COUNT));
+    cpu_set_timing(&cpu, (flags & FLAG_VIP) ? TIMING_VIP : TIMING_INSTRUCTIONS);
+
+    int64_t budget = (flags & FLAG_VIP) ? FUZZ_FRAME_BUDGET * 50 : FUZZ_FRAME_BUDGET;
+    uint8_t keypad[16] = {0};
+    for (size_t frame = 0; frame < FUZZ_FRAMES; frame++) {
+        if (frame < script_frames)
+            keypad_from_bits((uint16_t)(script[2 * frame] | (script[2 * frame + 1] << 8)), keypad);
+
+        int64_t spent = 0;
+        if (cpu_run_frame(&cpu, keypad, frame, budget, &spent) != 0)
+            break;//unknown instruction or stack error ends the run, like the emulator
+    }
+    return 0;
+}
+
+#ifdef CHIP8_FUZZ_MAIN
+/* Plain driver for AFL and for replaying crashes without libFuzzer */
+static int run_file(FILE *f) {
+    static uint8_t buf[MEMORY_SIZE + 512];
+    size_t size = fread(buf, 1, sizeof(buf), f);
+    return LLVMFuzzerTestOneInput(buf, size);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2)
+        return run_file(stdin);
+
+    for (int i = 1; i < argc; i++) {
+        FILE *f = fopen(argv[i], "rb");
+        if (!f) {
+            fprintf(stderr, "Failed to open %s\n", argv[i]);
+            return 1;
+        }
+        run_file(f);
+        fclose(f);
+    }
+    return 0;
+}
+#endif
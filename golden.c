@@ -0,0 +1,317 @@
+#include "golden.h"
+#include "SDL.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+
+#include "memory.h"
+#include "timer.h"
+#include "vmemory.h"
+#include "cpu.h"
+#include "replay.h"
+#include "chip8.h" // For DEFAULT_CPU_CLOCK
+
+#define GOLDEN_MAX_LINES 1024
+#define GOLDEN_MAX_CHECKS 64
+#define GOLDEN_MAX_JOBS 64
+#define GOLDEN_PATH_MAX 512
+
+typedef struct {
+    uint64_t frame;
+    uint64_t expected;
+    bool has_expected;
+    uint64_t actual;
+} GoldenCheck;
+
+typedef struct {
+    int line;//index into the manifest lines
+    char head[GOLDEN_PATH_MAX];//rom and options as written, kept by update
+    char rom[GOLDEN_PATH_MAX];
+    char input[GOLDEN_PATH_MAX];//empty if none
+    QuirkProfile profile;
+    TimingModel timing;
+    uint64_t cpu_clock;
+    GoldenCheck checks[GOLDEN_MAX_CHECKS];
+    int check_count;
+
+    /* results */
+    bool error;
+    uint64_t frames;
+    double seconds;
+} GoldenEntry;
+
+typedef struct {
+    GoldenEntry *entries;
+    int count;
+    SDL_atomic_t next;//work queue position
+} GoldenQueue;
+
+/* Paths in the manifest are relative to its directory */
+static void resolve_path(char *out, const char *manifest_path, const char *path) {
+    const char *slash = strrchr(manifest_path, '/');
+    const char *bslash = strrchr(manifest_path, '\\');
+    if (bslash > slash) slash = bslash;
+
+    bool absolute = path[0] == '/' || path[0] == '\\' || (path[0] && path[1] == ':');
+    if (absolute || !slash)
+        snprintf(out, GOLDEN_PATH_MAX, "%s", path);
+    else
+        snprintf(out, GOLDEN_PATH_MAX, "%.*s/%s", (int)(slash - manifest_path), manifest_path, path);
+}
+
+/* Split off the next whitespace separated field, NULL at the end of the line */
+static char *next_field(char **p) {
+    char *s = *p + strspn(*p, " \t\r\n");
+    if (*s == '\0')
+        return NULL;
+    char *end = s + strcspn(s, " \t\r\n");
+    if (*end) *end++ = '\0';
+    *p = end;
+    return s;
+}
+
+static int parse_entry(GoldenEntry *e, char *line, const char *manifest_path, int line_no) {
+    memset(e, 0, sizeof(*e));
+    e->profile = DEFAULT_QUIRK_PROFILE;
+    e->timing = TIMING_INSTRUCTIONS;
+    e->cpu_clock = DEFAULT_CPU_CLOCK;
+
+    for (char *tok; (tok = next_field(&line)) != NULL; ) {
+        char *colon = strchr(tok, ':');
+        char *eq = strchr(tok, '=');
+
+        if (!e->rom[0]) {
+            resolve_path(e->rom, manifest_path, tok);
+        } else if (eq) {
+            if (e->check_count) goto bad_token;//options go before the frames
+            *eq = '\0';
+            const char *value = eq + 1;
+            if (!strcmp(tok, "profile")) {
+                if (quirk_profile_from_str(value, &e->profile) != 0) goto bad_token;
+            } else if (!strcmp(tok, "timing")) {
+                if (!strcmp(value, "vip")) e->timing = TIMING_VIP;
+                else if (!strcmp(value, "clock")) e->timing = TIMING_INSTRUCTIONS;
+                else goto bad_token;
+            } else if (!strcmp(tok, "clock")) {
+                e->cpu_clock = strtoull(value, NULL, 10);
+                if (e->cpu_clock == 0) goto bad_token;
+            } else if (!strcmp(tok, "input")) {
+                resolve_path(e->input, manifest_path, value);
+            } else {
+                goto bad_token;
+            }
+            *eq = '=';
+        } else if (colon) {
+            if (e->check_count == GOLDEN_MAX_CHECKS) goto bad_token;
+            GoldenCheck *c = &e->checks[e->check_count];
+            char *end = NULL;
+            c->frame = strtoull(tok, &end, 10);
+            if (end != colon) goto bad_token;
+            if (e->check_count && c->frame <= e->checks[e->check_count - 1].frame) goto bad_token;//increasing
+            if (colon[1] != '\0') {
+                c->expected = strtoull(colon + 1, &end, 16);
+                if (*end != '\0') goto bad_token;
+                c->has_expected = true;
+            }
+            e->check_count++;
+            continue;
+        } else {
+            goto bad_token;
+        }
+        /* rom and options are written back unchanged by update */
+        size_t used = strlen(e->head);
+        snprintf(e->head + used, sizeof(e->head) - used, "%s%s", used ? " " : "", tok);
+        continue;
+
+    bad_token:
+        if (eq) *eq = '=';
+        fprintf(stderr, "[golden] %s:%d bad field \"%s\"\n", manifest_path, line_no, tok);
+        return 1;
+    }
+    if (e->check_count == 0) {
+        fprintf(stderr, "[golden] %s:%d no <frame>:<hash> to check\n", manifest_path, line_no);
+        return 1;
+    }
+    return 0;
+}
+
+/* Same frame order as emulate_chip8: input, CPU budget, then the screen is final */
+static void golden_play(GoldenEntry *e) {
+    size_t rom_size = 0;
+    uint8_t *program = memory_read_rom(e->rom, &rom_size);
+    if (!program) {
+        fprintf(stderr, "[golden] failed to read ROM: %s\n", e->rom);
+        e->error = true;
+        return;
+    }
+    Replay replay;
+    if (replay_open(&replay, e->input[0] ? e->input : NULL, NULL) != 0) {
+        free(program);
+        e->error = true;
+        return;
+    }
+
+    Memory mem;
+    Timer timer;
+    VMemory vmemory;
+    Cpu cpu;
+    if (memory_new(&mem, program, rom_size) != 0) {
+        fprintf(stderr, "[golden] ROM does not fit in memory: %s\n", e->rom);
+        replay_close(&replay);
+        free(program);
+        e->error = true;
+        return;
+    }
+    timer_init(&timer);
+    vmemory_init(&vmemory);
+    cpu_new(&cpu, &mem, &timer, &vmemory);
+    cpu_set_profile(&cpu, e->profile);
+    cpu_set_timing(&cpu, e->timing);
+
+    uint64_t start = SDL_GetPerformanceCounter();
+    uint64_t last = e->checks[e->check_count - 1].frame;
+    uint8_t keypad[16];
+    int64_t credit = 0;
+    int next = 0;
+
+    for (uint64_t frame = 0; ; frame++) {
+        while (next < e->check_count && e->checks[next].frame == frame)
+            e->checks[next++].actual = vmemory_hash(&cpu.vmemory);//screen after 'frame' frames
+        if (frame == last)
+            break;
+
+        keypad_from_bits(replay_keys(&replay, frame), keypad);
+
+        int64_t spent = 0;
+        credit += cpu_frame_budget(e->timing, e->cpu_clock, frame);
+        cpu_run_frame(&cpu, keypad, frame, credit, &spent);
+        credit -= spent;
+        if (credit > 0)
+            credit = 0;
+        cpu.vmemory.draw_flag = false;
+    }
+
+    e->frames = last;
+    e->seconds = (double)(SDL_GetPerformanceCounter() - start) / (double)SDL_GetPerformanceFrequency();
+    memory_free(&mem);
+    replay_close(&replay);
+    free(program);
+}
+
+static int golden_worker(void *data) {
+    GoldenQueue *q = data;
+    int i;
+    while ((i = SDL_AtomicAdd(&q->next, 1)) < q->count)
+        golden_play(&q->entries[i]);
+    return 0;
+}
+
+static int write_manifest(const char *path, char **lines, int line_count, const GoldenEntry *entries, int count) {
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "[golden] failed to write %s\n", path);
+        return 1;
+    }
+    int e = 0;
+    for (int l = 0; l < line_count; l++) {
+        if (e < count && entries[e].line == l) {
+            fputs(entries[e].head, f);
+            for (int c = 0; c < entries[e].check_count; c++)
+                fprintf(f, " %" PRIu64 ":%016" PRIx64, entries[e].checks[c].frame, entries[e].checks[c].actual);
+            fputc('\n', f);
+            e++;
+        } else {
+            fputs(lines[l], f);
+        }
+    }
+    fclose(f);
+    return 0;
+}
+
+int golden_run(const char *manifest_path, bool update, int jobs) {
+    FILE *f = fopen(manifest_path, "r");
+    if (!f) {
+        fprintf(stderr, "[golden] failed to open manifest: %s\n", manifest_path);
+        return 1;
+    }
+
+    static char *lines[GOLDEN_MAX_LINES];
+    GoldenEntry *entries = calloc(GOLDEN_MAX_LINES, sizeof(*entries));
+    int line_count = 0, count = 0, rc = 0;
+    char buf[4096];
+
+    while (rc == 0 && fgets(buf, sizeof(buf), f)) {
+        if (line_count == GOLDEN_MAX_LINES) {
+            fprintf(stderr, "[golden] %s has more than %d lines\n", manifest_path, GOLDEN_MAX_LINES);
+            rc = 1;
+            break;
+        }
+        lines[line_count] = strdup(buf);
+
+        char *p = buf;
+        while (*p == ' ' || *p == '\t') p++;
+        if (*p != '#' && *p != '\n' && *p != '\r' && *p != '\0') {
+            if (parse_entry(&entries[count], p, manifest_path, line_count + 1) != 0)
+                rc = 1;
+            entries[count++].line = line_count;
+        }
+        line_count++;
+    }
+    fclose(f);
+
+    if (rc == 0) {
+        if (jobs <= 0) jobs = SDL_GetCPUCount();
+        if (jobs > count) jobs = count;
+        if (jobs > GOLDEN_MAX_JOBS) jobs = GOLDEN_MAX_JOBS;
+
+        GoldenQueue queue = { entries, count, {0} };
+        SDL_Thread *threads[GOLDEN_MAX_JOBS];
+        uint64_t start = SDL_GetPerformanceCounter();
+        for (int t = 0; t < jobs; t++)
+            threads[t] = SDL_CreateThread(golden_worker, "golden", &queue);
+        for (int t = 0; t < jobs; t++) {
+            if (threads[t]) SDL_WaitThread(threads[t], NULL);
+            else golden_worker(&queue);//no thread, run the rest on this one
+        }
+        double seconds = (double)(SDL_GetPerformanceCounter() - start) / (double)SDL_GetPerformanceFrequency();
+
+        /* Report in manifest order */
+        int failed = 0;
+        uint64_t frames = 0;
+        for (int i = 0; i < count; i++) {
+            GoldenEntry *e = &entries[i];
+            frames += e->frames;
+            if (e->error) {
+                printf("ERROR %s\n", e->rom);
+                failed++;
+                continue;
+            }
+            bool ok = true;
+            for (int c = 0; c < e->check_count && !update; c++) {
+                if (!e->checks[c].has_expected || e->checks[c].expected != e->checks[c].actual) {
+                    printf("FAIL  %s frame %" PRIu64 ": expected %016" PRIx64 " got %016" PRIx64 "\n",
+                           e->rom, e->checks[c].frame, e->checks[c].expected, e->checks[c].actual);
+                    ok = false;
+                }
+            }
+            if (ok)
+                printf("%s %s (%" PRIu64 " frames, %.3fs)\n", update ? "HASH " : "PASS ", e->rom, e->frames, e->seconds);
+            else
+                failed++;
+        }
+        printf("golden: %d passed, %d failed, %" PRIu64 " frames in %.3fs (%.0f frames/s, %d jobs)\n",
+               count - failed, failed, frames, seconds, seconds > 0 ? (double)frames / seconds : 0.0, jobs);
+
+        if (failed)
+            rc = 1;
+        else if (update)
+            rc = write_manifest(manifest_path, lines, line_count, entries, count);
+    }
+
+    for (int l = 0; l < line_count; l++)
+        free(lines[l]);
+    free(entries);
+    return rc;
+}
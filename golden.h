@@ -0,0 +1,19 @@
+#ifndef GOLDEN_H
+#define GOLDEN_H
+
+#include <stdbool.h>
+
+/*
+ * Golden frame regression runner. Every manifest line plays one ROM headless and compares
+ * vmemory_hash() of the screen after the listed frames:
+ *
+ *   <rom> [profile=<p>] [timing=clock|vip] [clock=<hz>] [input=<script>] <frame>:<hash> ...
+ *
+ * Paths are relative to the manifest. An empty hash ("600:") is filled in by update mode.
+ * ROMs run in parallel on 'jobs' threads (0 = one per CPU core).
+ * update rewrites the manifest with the hashes just computed.
+ * Returns 0 when every frame matched (or the manifest was updated).
+ */
+int golden_run(const char *manifest_path, bool update, int jobs);
+
+#endif
@@ -1,9 +1,32 @@
 #include "input.h"
 #include <string.h>
 
+/* Host key of every CHIP-8 key 0..F */
+static const SDL_Scancode KEYMAP[16] = {
+    SDL_SCANCODE_X, SDL_SCANCODE_1, SDL_SCANCODE_2, SDL_SCANCODE_3,
+    SDL_SCANCODE_Q, SDL_SCANCODE_W, SDL_SCANCODE_E, SDL_SCANCODE_A,
+    SDL_SCANCODE_S, SDL_SCANCODE_D, SDL_SCANCODE_Z, SDL_SCANCODE_C,
+    SDL_SCANCODE_4, SDL_SCANCODE_R, SDL_SCANCODE_F, SDL_SCANCODE_V
+};
+
 void input_init(InputHandler *ih) {
-    /* Nothing special needed in C, but keep symmetry */
-    (void)ih;
+    memset(ih->key_event, 0, sizeof(ih->key_event));
+}
+
+/* Keypad transition: when did SDL receive it (event timestamps are milliseconds since SDL_Init) */
+static void stamp_key_event(InputHandler *ih, const SDL_KeyboardEvent *key) {
+    if (key->repeat)
+        return;
+    for (int k = 0; k < 16; k++) {
+        if (KEYMAP[k] != key->keysym.scancode)
+            continue;
+        if (ih->key_event[k] == 0) {
+            uint64_t now = SDL_GetPerformanceCounter();
+            uint64_t age = (uint64_t)(Uint32)(SDL_GetTicks() - key->timestamp) * SDL_GetPerformanceFrequency() / 1000;
+            ih->key_event[k] = now > age ? now - age : 1;
+        }
+        return;
+    }
 }
 
 void input_poll(InputHandler *ih, InputEvent *out_event) {
@@ -13,6 +36,8 @@ void input_poll(InputHandler *ih, InputEvent *out_event) {
     while (SDL_PollEvent(&ih->event)) {
         if (ih->event.type == SDL_QUIT) {
             out_event->quit = 1;
+        } else if (ih->event.type == SDL_KEYDOWN || ih->event.type == SDL_KEYUP) {
+            stamp_key_event(ih, &ih->event.key);
         }
     }
 
@@ -21,31 +46,16 @@ void input_poll(InputHandler *ih, InputEvent *out_event) {
 
     /* CHIP-8 keypad mapping*/
 
-    if (state[SDL_SCANCODE_1]) out_event->keypad[0x1] = 1;
-    if (state[SDL_SCANCODE_2]) out_event->keypad[0x2] = 1;
-    if (state[SDL_SCANCODE_3]) out_event->keypad[0x3] = 1;
-    if (state[SDL_SCANCODE_4]) out_event->keypad[0xC] = 1;
-
-    if (state[SDL_SCANCODE_Q]) out_event->keypad[0x4] = 1;
-    if (state[SDL_SCANCODE_W]) out_event->keypad[0x5] = 1;
-    if (state[SDL_SCANCODE_E]) out_event->keypad[0x6] = 1;
-    if (state[SDL_SCANCODE_R]) out_event->keypad[0xD] = 1;
-
-    if (state[SDL_SCANCODE_A]) out_event->keypad[0x7] = 1;
-    if (state[SDL_SCANCODE_S]) out_event->keypad[0x8] = 1;
-    if (state[SDL_SCANCODE_D]) out_event->keypad[0x9] = 1;
-    if (state[SDL_SCANCODE_F]) out_event->keypad[0xE] = 1;
-
-    if (state[SDL_SCANCODE_Z]) out_event->keypad[0xA] = 1;
-    if (state[SDL_SCANCODE_X]) out_event->keypad[0x0] = 1;
-    if (state[SDL_SCANCODE_C]) out_event->keypad[0xB] = 1;
-    if (state[SDL_SCANCODE_V]) out_event->keypad[0xF] = 1;
+    for (int k = 0; k < 16; k++)
+        if (state[KEYMAP[k]]) out_event->keypad[k] = 1;
 
     if (state[SDL_SCANCODE_O]) out_event->dbg_pause = 1;
     if (state[SDL_SCANCODE_U]) out_event->dbg_resume = 1;
     if (state[SDL_SCANCODE_I]) out_event->dbg_step = 1;
     if (state[SDL_SCANCODE_B]) out_event->dbg_break = 1;
     if (state[SDL_SCANCODE_N]) out_event->dbg_clear_break = 1;
+    if (state[SDL_SCANCODE_J]) out_event->dbg_step_back = 1;
+    if (state[SDL_SCANCODE_H]) out_event->dbg_reverse = 1;
 
 
     /* Quit on ESC */
@@ -53,8 +63,59 @@ void input_poll(InputHandler *ih, InputEvent *out_event) {
         out_event->quit = 1;
     }
 
+    /* Fast-forward while Tab is held */
+    if (state[SDL_SCANCODE_TAB]) {
+        out_event->turbo = 1;
+    }
+
     /* Restart on Space*/
     if (state[SDL_SCANCODE_SPACE]) {
         out_event->restart = 1;
     }
 }
+
+enum {
+    INPUT_BIT_QUIT = 16,
+    INPUT_BIT_RESTART,
+    INPUT_BIT_TURBO,
+    INPUT_BIT_DBG_PAUSE,
+    INPUT_BIT_DBG_RESUME,
+    INPUT_BIT_DBG_STEP,
+    INPUT_BIT_DBG_BREAK,
+    INPUT_BIT_DBG_CLEAR_BREAK,
+    INPUT_BIT_DBG_STEP_BACK,
+    INPUT_BIT_DBG_REVERSE
+};
+
+uint32_t input_to_bits(const InputEvent *ev) {
+    uint32_t bits = 0;
+    for (int k = 0; k < 16; k++)
+        if (ev->keypad[k])
+            bits |= 1u << k;
+    if (ev->quit) bits |= 1u << INPUT_BIT_QUIT;
+    if (ev->restart) bits |= 1u << INPUT_BIT_RESTART;
+    if (ev->turbo) bits |= 1u << INPUT_BIT_TURBO;
+    if (ev->dbg_pause) bits |= 1u << INPUT_BIT_DBG_PAUSE;
+    if (ev->dbg_resume) bits |= 1u << INPUT_BIT_DBG_RESUME;
+    if (ev->dbg_step) bits |= 1u << INPUT_BIT_DBG_STEP;
+    if (ev->dbg_break) bits |= 1u << INPUT_BIT_DBG_BREAK;
+    if (ev->dbg_clear_break) bits |= 1u << INPUT_BIT_DBG_CLEAR_BREAK;
+    if (ev->dbg_step_back) bits |= 1u << INPUT_BIT_DBG_STEP_BACK;
+    if (ev->dbg_reverse) bits |= 1u << INPUT_BIT_DBG_REVERSE;
+    return bits;
+}
+
+void input_from_bits(uint32_t bits, InputEvent *out_event) {
+    for (int k = 0; k < 16; k++)
+        out_event->keypad[k] = (bits >> k) & 1;
+    out_event->quit = (bits >> INPUT_BIT_QUIT) & 1;
+    out_event->restart = (bits >> INPUT_BIT_RESTART) & 1;
+    out_event->turbo = (bits >> INPUT_BIT_TURBO) & 1;
+    out_event->dbg_pause = (bits >> INPUT_BIT_DBG_PAUSE) & 1;
+    out_event->dbg_resume = (bits >> INPUT_BIT_DBG_RESUME) & 1;
+    out_event->dbg_step = (bits >> INPUT_BIT_DBG_STEP) & 1;
+    out_event->dbg_break = (bits >> INPUT_BIT_DBG_BREAK) & 1;
+    out_event->dbg_clear_break = (bits >> INPUT_BIT_DBG_CLEAR_BREAK) & 1;
+    out_event->dbg_step_back = (bits >> INPUT_BIT_DBG_STEP_BACK) & 1;
+    out_event->dbg_reverse = (bits >> INPUT_BIT_DBG_REVERSE) & 1;
+}
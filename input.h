@@ -8,6 +8,7 @@ typedef struct {//@TODO: make it bool
     int quit;               /* bool */
     int restart;            /* bool */
     uint8_t keypad[16];     /* keypad state (0/1) */
+    int turbo;              /* fast-forward key held */
 
     /* Debugger commands */
     int dbg_pause;
@@ -15,11 +16,14 @@ typedef struct {//@TODO: make it bool
     int dbg_step;
     int dbg_break;
     int dbg_clear_break;
+    int dbg_step_back;
+    int dbg_reverse;
 } InputEvent;
 
 typedef struct {
     SDL_Event event;
     InputEvent ev;
+    uint64_t key_event[16];//performance counter of the oldest unconsumed press/release per key, 0 = none (latency probe)
 } InputHandler;
 
 void input_init(InputHandler *ih);
@@ -27,4 +31,8 @@ void input_init(InputHandler *ih);
 /* Poll events and fill InputEvent */
 void input_poll(InputHandler *ih, InputEvent *out_event);
 
+/* InputEvent packed into one word (keypad in bits 0-15), to hand it to another thread atomically */
+uint32_t input_to_bits(const InputEvent *ev);
+void input_from_bits(uint32_t bits, InputEvent *out_event);
+
 #endif /* INPUT_H */
@@ -0,0 +1,113 @@
+#include "latency.h"
+#include <stdio.h>
+#include <string.h>
+
+#define BAR_WIDTH 40
+
+void latency_init(LatencyProbe *p, bool enabled) {
+    memset(p, 0, sizeof(*p));
+    p->enabled = enabled;
+    p->freq = SDL_GetPerformanceFrequency();
+}
+
+static uint64_t to_us(const LatencyProbe *p, uint64_t ticks) {
+    return ticks * 1000000ULL / p->freq;
+}
+
+void latency_input(LatencyProbe *p, InputHandler *ih) {
+    if (!p->enabled)
+        return;
+    uint64_t now = SDL_GetPerformanceCounter();
+    for (int k = 0; k < 16; k++) {
+        if (ih->key_event[k] == 0)
+            continue;
+        KeyProbe *kp = &p->keys[k];
+        if (kp->event)
+            p->superseded++;//only the newest transition is followed
+        memset(kp, 0, sizeof(*kp));
+        kp->event = ih->key_event[k];
+        kp->polled = now;
+        ih->key_event[k] = 0;
+    }
+}
+
+void latency_frame(LatencyProbe *p, Cpu *cpu) {
+    if (!p->enabled)
+        return;
+    uint64_t now = SDL_GetPerformanceCounter();
+    for (int k = 0; k < 16; k++) {
+        KeyProbe *kp = &p->keys[k];
+        if (kp->event == 0 || kp->drawn)
+            continue;
+        if (!kp->observed && (cpu->key_observed & (1u << k))) {
+            kp->observed = now;
+            kp->draws = cpu->key_observed_draws[k];
+        }
+        if (kp->observed && cpu->draws != kp->draws) {
+            kp->drawn = true;//shown by the next present
+            continue;
+        }
+        if (++kp->frames > LATENCY_TIMEOUT_FRAMES) {
+            if (kp->observed) p->undrawn++;
+            else p->unread++;
+            kp->event = 0;
+        }
+    }
+    cpu->key_observed = 0;//reads before the next poll belong to the next transition
+}
+
+void latency_present(LatencyProbe *p) {
+    if (!p->enabled)
+        return;
+    uint64_t now = SDL_GetPerformanceCounter();
+    for (int k = 0; k < 16; k++) {
+        KeyProbe *kp = &p->keys[k];
+        if (kp->event == 0 || !kp->drawn)
+            continue;
+        histogram_add(&p->to_poll, to_us(p, kp->polled - kp->event));
+        histogram_add(&p->to_observe, to_us(p, kp->observed - kp->event));
+        histogram_add(&p->to_present, to_us(p, now - kp->event));
+        kp->event = 0;
+    }
+}
+
+static void print_stage(const char *name, const Histogram *h) {
+    fprintf(stderr, "[latency] %-14s %8.2f %8.2f %8.2f %8.2f\n", name,
+            h->samples ? (double)h->sum / (double)h->samples / 1000.0 : 0.0,
+            (double)histogram_percentile(h, 50) / 1000.0,
+            (double)histogram_percentile(h, 99) / 1000.0,
+            (double)h->max / 1000.0);
+}
+
+void latency_report(const LatencyProbe *p) {
+    if (!p->enabled)
+        return;
+    const Histogram *h = &p->to_present;
+    fprintf(stderr, "[latency] %llu key transitions measured, %llu never read, %llu read without a draw, %llu superseded\n",
+            (unsigned long long)h->samples, (unsigned long long)p->unread,
+            (unsigned long long)p->undrawn, (unsigned long long)p->superseded);
+    if (h->samples == 0)
+        return;
+    fprintf(stderr, "[latency] %-14s %8s %8s %8s %8s (ms)\n", "from event to", "mean", "p50", "p99", "max");
+    print_stage("poll", &p->to_poll);
+    print_stage("read (Ex/Fx0A)", &p->to_observe);
+    print_stage("present", &p->to_present);
+
+    /* event -> present, log2 buckets like the --stats histograms */
+    uint32_t first = HIST_BUCKETS, last = 0, peak = 0;
+    for (uint32_t b = 0; b < HIST_BUCKETS; b++) {
+        if (!h->counts[b])
+            continue;
+        if (first == HIST_BUCKETS) first = b;
+        last = b;
+        if (h->counts[b] > peak) peak = h->counts[b];
+    }
+    for (uint32_t b = first; b <= last; b++) {
+        char bar[BAR_WIDTH + 1];
+        uint32_t len = (uint32_t)((uint64_t)h->counts[b] * BAR_WIDTH / peak);
+        memset(bar, '#', len);
+        bar[len] = '\0';
+        uint64_t upper = 1ULL << b;
+        fprintf(stderr, "[latency] < %8.2fms %6u %s\n", (double)upper / 1000.0, h->counts[b], bar);
+    }
+}
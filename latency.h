@@ -0,0 +1,51 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "metrics.h"
+#include "input.h"
+#include "cpu.h"
+
+/* Give up on a key transition the program didn't read (or didn't answer with a draw) within this many frames */
+#define LATENCY_TIMEOUT_FRAMES 30
+
+/*
+ * --latency: input-to-photon time of every keypad press and release.
+ * A transition is followed from its SDL event through the poll that saw it, the first Ex9E/ExA1/Fx0A
+ * that read the key and the first Dxyn/00E0 after that read, up to the SDL_RenderPresent of that frame.
+ * The CPU only counts (cpu.draws, cpu.key_observed), the probe turns the counts into times once per frame,
+ * so a read is timed to the end of the emulated frame it happened in.
+ */
+typedef struct {
+    uint64_t event;//SDL event timestamp as performance counter, 0 = nothing in flight
+    uint64_t polled;//input_poll returned it
+    uint64_t observed;//end of the frame the program read the key in, 0 = not read yet
+    uint32_t draws;//cpu.draws when the key was read
+    bool drawn;//a draw followed the read, waiting for the present
+    uint32_t frames;//emulated frames since the poll
+} KeyProbe;
+
+typedef struct {
+    bool enabled;
+    uint64_t freq;
+    KeyProbe keys[16];
+    Histogram to_poll;//microseconds, event -> poll
+    Histogram to_observe;//event -> read by the program
+    Histogram to_present;//event -> on screen
+    uint64_t unread;//transitions the program never read
+    uint64_t undrawn;//read, but nothing drawn after
+    uint64_t superseded;//the key changed again before the last change reached the screen
+} LatencyProbe;
+
+void latency_init(LatencyProbe *p, bool enabled);
+/* After input_poll: take the new key transitions */
+void latency_input(LatencyProbe *p, InputHandler *ih);
+/* After every emulated frame */
+void latency_frame(LatencyProbe *p, Cpu *cpu);
+/* Right after SDL_RenderPresent */
+void latency_present(LatencyProbe *p);
+/* Summary and histogram on stderr */
+void latency_report(const LatencyProbe *p);
+
+#endif
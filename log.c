@@ -0,0 +1,78 @@
+#include "log.h"
+#include <stdarg.h>
+#include <stdint.h>
+
+/* Bounded multi-producer queue: a slot is free for position p when seq == p, filled when seq == p + 1 */
+typedef struct {
+    uint32_t seq;
+    char text[LOG_LINE_MAX];
+} LogSlot;
+
+static LogSlot slots[LOG_SLOTS];
+static uint32_t tail;//next position to fill, shared by the producers
+static uint32_t head;//next position to drain, consumer only
+static uint32_t dropped;
+static bool async_mode;
+
+void log_printf(const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    if (!__atomic_load_n(&async_mode, __ATOMIC_ACQUIRE)) {
+        vfprintf(stderr, fmt, args);
+        va_end(args);
+        return;
+    }
+
+    uint32_t pos = __atomic_load_n(&tail, __ATOMIC_RELAXED);
+    LogSlot *s;
+    for (;;) {
+        s = &slots[pos & (LOG_SLOTS - 1)];
+        int32_t diff = (int32_t)(__atomic_load_n(&s->seq, __ATOMIC_ACQUIRE) - pos);
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&tail, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                break;//pos is ours
+        } else if (diff < 0) {//the consumer is a whole ring behind
+            __atomic_fetch_add(&dropped, 1, __ATOMIC_RELAXED);
+            va_end(args);
+            return;
+        } else {
+            pos = __atomic_load_n(&tail, __ATOMIC_RELAXED);//another producer took it
+        }
+    }
+    vsnprintf(s->text, sizeof(s->text), fmt, args);
+    va_end(args);
+    __atomic_store_n(&s->seq, pos + 1, __ATOMIC_RELEASE);
+}
+
+void log_set_async(bool async) {
+    if (async == async_mode)
+        return;
+    if (async) {
+        for (uint32_t i = 0; i < LOG_SLOTS; i++)
+            slots[i].seq = i;
+        head = tail = 0;
+        dropped = 0;
+    } else {
+        log_drain(stderr);
+    }
+    __atomic_store_n(&async_mode, async, __ATOMIC_RELEASE);
+}
+
+size_t log_drain(FILE *out) {
+    size_t lines = 0;
+    for (;;) {
+        LogSlot *s = &slots[head & (LOG_SLOTS - 1)];
+        if (__atomic_load_n(&s->seq, __ATOMIC_ACQUIRE) != head + 1)
+            break;
+        fputs(s->text, out);
+        __atomic_store_n(&s->seq, head + LOG_SLOTS, __ATOMIC_RELEASE);//free for the next round
+        head++;
+        lines++;
+    }
+    uint32_t lost = __atomic_exchange_n(&dropped, 0, __ATOMIC_RELAXED);
+    if (lost)
+        fprintf(out, "[log] %u lines dropped\n", (unsigned)lost);
+    if (lines || lost)
+        fflush(out);
+    return lines;
+}
@@ -0,0 +1,28 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/*
+ * Diagnostics (debugger, CPU errors). Synchronous on stderr by default. In async mode log_printf only
+ * formats the line into a fixed ring of slots and returns, it never blocks on the terminal: a line that
+ * finds the ring full is dropped and counted. Any thread may log, one thread calls log_drain.
+ * No SDL, the core library logs through it too.
+ */
+#define LOG_SLOTS 256 //power of two
+#define LOG_LINE_MAX 160 //longer lines are cut
+
+#if defined(__GNUC__)
+__attribute__((format(printf, 1, 2)))
+#endif
+void log_printf(const char *fmt, ...);
+
+/* Switch modes while nothing else logs (startup, shutdown). Leaving async mode drains to stderr first */
+void log_set_async(bool async);
+
+/* Write the queued lines to 'out', then a note if some were dropped. Returns the number of lines written */
+size_t log_drain(FILE *out);
+
+#endif /* LOG_H */
@@ -8,6 +8,8 @@
 #include "memory.h"
 #include "timer.h"
 #include "vmemory.h"
+#include "golden.h"
+#include "validate.h"
 
 #include "display.h"
 
@@ -20,13 +22,54 @@ static void terminate_with_error(const char *msg) {
 
 int main(int argc, char *argv[]) {
 
+    if (argc >= 2 && !strcmp(argv[1], "--golden")) {
+        if (argc < 3) terminate_with_error("Missing value for --golden");
+        bool update = false;
+        int jobs = 0;
+        for (int i = 3; i < argc; i++) {
+            if (!strcmp(argv[i], "--golden-update")) {
+                update = true;
+            } else if (!strcmp(argv[i], "-j") || !strcmp(argv[i], "--jobs")) {
+                if (i + 1 < argc) jobs = atoi(argv[++i]);
+                else terminate_with_error("Missing value for --jobs");
+            } else {
+                terminate_with_error("Unknown option for --golden");
+            }
+        }
+        return golden_run(argv[2], update, jobs) == 0 ? 0 : 1;
+    }
+
     if (argc < 2) {
         printf("Usage: %s <ROM> [options]\n", argv[0]);
+        printf("       %s --golden <manifest> [--golden-update] [-j <threads>]\n", argv[0]);
         printf("\nOptions:\n");
         printf("  -m, --mute           Mutes emulator audio\n");
         printf("  -t, --theme <value>  Color theme (r,g,b,br,bg,bb,bw). Default bw\n");
         printf("  -s, --scale <value>  Pixel scale [1–100]. Default 10\n");
-        printf("  -c, --clock <value>  CPU clock [300–1000]. Default 600\n");
+        printf("  -c, --clock <value>  CPU clock [1–1000000]. Default 600\n");
+        printf("  -q, --profile-quirks <value>  Quirk profile (chip8, schip, xochip, legacy). Default legacy\n");
+        printf("      --timing <value>  CPU timing (clock, vip). vip costs each opcode in COSMAC VIP cycles. Default clock\n");
+        printf("      --stats          Print frame pacing statistics to stderr every 5 seconds\n");
+        printf("      --stats-file <path>  Write per frame timings to a CSV file\n");
+        printf("      --stats-overlay  Draw per frame timing bars over the game\n");
+        printf("      --headless       No window, audio or input, run as fast as possible\n");
+        printf("      --frames <value> Stop after this many 60Hz frames\n");
+        printf("      --capture-video <path|->  Write every frame as raw video (- for stdout)\n");
+        printf("      --capture-format <value>  Raw video layout (packed 1bpp 64x32, rgb scaled RGB24). Default packed\n");
+        printf("      --capture-audio <path>    Write the beeper as raw signed 16 bit mono, 11025Hz\n");
+        printf("      --turbo <value>  Fast-forward speed [2–64] while Tab is held. Default 4\n");
+        printf("      --run-ahead <value>  Show the screen this many frames ahead [0–8] to hide the ROM's input lag. Default 0\n");
+        printf("      --stream <-|unix:path>  Stream screen deltas to stdout or a Unix socket, keypad input comes back\n");
+        printf("      --phosphor <value>  Keep this percent of the old picture per frame [0–95] against flicker. Default 0\n");
+        printf("      --crt            Scale on the CPU with aperture grille and scanlines\n");
+        printf("      --startup-trace  Print how long each startup step takes, up to the first frame\n");
+        printf("      --threaded       Run the emulation on its own thread, the main thread only renders\n");
+        printf("      --latency        Measure keypad event to screen time, histogram on exit\n");
+        printf("      --wall <value>   Run this many instances [1–1024] tiled in one window, keys go to all\n");
+        printf("      --term           Draw in the terminal with Unicode half blocks, keys from stdin (for SSH)\n");
+        printf("      --validate       Check the fast CPU engine against the reference interpreter, frame by frame\n");
+        printf("      --input-script <path>  Play keypad input from a recording instead of the keyboard\n");
+        printf("      --record-input <path>  Record keypad input (frame and keys per change)\n");
         return 1;
     }
 
@@ -35,6 +78,29 @@ int main(int argc, char *argv[]) {
     const char *theme_str = NULL;
     const char *scale_str = NULL;
     const char *clock_str = NULL;
+    const char *profile_str = NULL;
+    TimingModel timing = TIMING_INSTRUCTIONS;
+    bool stats = false;
+    bool stats_overlay = false;
+    const char *stats_file = NULL;
+    bool headless = false;
+    uint64_t max_frames = 0;
+    const char *capture_video = NULL;
+    const char *capture_audio = NULL;
+    CaptureFormat capture_format = CAPTURE_PACKED;
+    const char *input_script = NULL;
+    const char *record_input = NULL;
+    uint32_t turbo = DEFAULT_TURBO;
+    uint32_t run_ahead = 0;
+    bool threaded = false;
+    uint32_t phosphor = 0;
+    const char *stream = NULL;
+    bool startup_trace = false;
+    bool crt = false;
+    bool latency = false;
+    uint32_t wall = 0;
+    bool validate = false;
+    bool term = false;
 
     for (int i = 2; i < argc; i++) {
 
@@ -56,6 +122,136 @@ int main(int argc, char *argv[]) {
             if (i + 1 < argc) clock_str = argv[++i];
             else terminate_with_error("Missing value for --clock");
         }
+
+        else if (!strcmp(argv[i], "-q") || !strcmp(argv[i], "--profile-quirks")) {
+            if (i + 1 < argc) profile_str = argv[++i];
+            else terminate_with_error("Missing value for --profile-quirks");
+        }
+
+        else if (!strcmp(argv[i], "--timing")) {
+            if (i + 1 >= argc) terminate_with_error("Missing value for --timing");
+            i++;
+            if (!strcmp(argv[i], "vip")) timing = TIMING_VIP;
+            else if (!strcmp(argv[i], "clock")) timing = TIMING_INSTRUCTIONS;
+            else terminate_with_error("--timing must be clock or vip");
+        }
+
+        else if (!strcmp(argv[i], "--stats")) {
+            stats = true;
+        }
+
+        else if (!strcmp(argv[i], "--stats-file")) {
+            if (i + 1 < argc) stats_file = argv[++i];
+            else terminate_with_error("Missing value for --stats-file");
+        }
+
+        else if (!strcmp(argv[i], "--stats-overlay")) {
+            stats_overlay = true;
+        }
+
+        else if (!strcmp(argv[i], "--headless")) {
+            headless = true;
+        }
+
+        else if (!strcmp(argv[i], "--stream")) {
+            if (i + 1 < argc) stream = argv[++i];
+            else terminate_with_error("Missing value for --stream");
+        }
+
+        else if (!strcmp(argv[i], "--phosphor")) {
+            if (i + 1 >= argc) terminate_with_error("Missing value for --phosphor");
+            char *endptr = NULL;
+            unsigned long v = strtoul(argv[++i], &endptr, 10);
+            if (endptr == argv[i] || *endptr != '\0' || v > MAX_PHOSPHOR)
+                terminate_with_error("--phosphor must be an Integer within [0, 95]");
+            phosphor = (uint32_t)v;
+        }
+
+        else if (!strcmp(argv[i], "--crt")) {
+            crt = true;
+        }
+
+        else if (!strcmp(argv[i], "--startup-trace")) {
+            startup_trace = true;
+        }
+
+        else if (!strcmp(argv[i], "--threaded")) {
+            threaded = true;
+        }
+
+        else if (!strcmp(argv[i], "--term")) {
+            term = true;
+        }
+
+        else if (!strcmp(argv[i], "--validate")) {
+            validate = true;
+        }
+
+        else if (!strcmp(argv[i], "--latency")) {
+            latency = true;
+        }
+
+        else if (!strcmp(argv[i], "--frames")) {
+            if (i + 1 >= argc) terminate_with_error("Missing value for --frames");
+            char *endptr = NULL;
+            max_frames = strtoull(argv[++i], &endptr, 10);
+            if (endptr == argv[i] || *endptr != '\0') terminate_with_error("--frames must be an Integer");
+        }
+
+        else if (!strcmp(argv[i], "--capture-video")) {
+            if (i + 1 < argc) capture_video = argv[++i];
+            else terminate_with_error("Missing value for --capture-video");
+        }
+
+        else if (!strcmp(argv[i], "--capture-audio")) {
+            if (i + 1 < argc) capture_audio = argv[++i];
+            else terminate_with_error("Missing value for --capture-audio");
+        }
+
+        else if (!strcmp(argv[i], "--capture-format")) {
+            if (i + 1 >= argc) terminate_with_error("Missing value for --capture-format");
+            i++;
+            if (!strcmp(argv[i], "packed")) capture_format = CAPTURE_PACKED;
+            else if (!strcmp(argv[i], "rgb")) capture_format = CAPTURE_RGB;
+            else terminate_with_error("--capture-format must be packed or rgb");
+        }
+
+        else if (!strcmp(argv[i], "--turbo")) {
+            if (i + 1 >= argc) terminate_with_error("Missing value for --turbo");
+            char *endptr = NULL;
+            unsigned long v = strtoul(argv[++i], &endptr, 10);
+            if (endptr == argv[i] || *endptr != '\0' || v < 2 || v > MAX_TURBO)
+                terminate_with_error("--turbo must be an Integer within [2, 64]");
+            turbo = (uint32_t)v;
+        }
+
+        else if (!strcmp(argv[i], "--run-ahead")) {
+            if (i + 1 >= argc) terminate_with_error("Missing value for --run-ahead");
+            char *endptr = NULL;
+            unsigned long v = strtoul(argv[++i], &endptr, 10);
+            if (endptr == argv[i] || *endptr != '\0' || v > MAX_RUN_AHEAD)
+                terminate_with_error("--run-ahead must be an Integer within [0, 8]");
+            run_ahead = (uint32_t)v;
+        }
+
+        else if (!strcmp(argv[i], "--wall")) {
+            if (i + 1 >= argc) terminate_with_error("Missing value for --wall");
+            char *endptr = NULL;
+            unsigned long v = strtoul(argv[++i], &endptr, 10);
+            if (endptr == argv[i] || *endptr != '\0' || v < 1 || v > MAX_WALL)
+                terminate_with_error("--wall must be an Integer within [1, 1024]");
+            wall = (uint32_t)v;
+        }
+
+        else if (!strcmp(argv[i], "--input-script")) {
+            if (i + 1 < argc) input_script = argv[++i];
+            else terminate_with_error("Missing value for --input-script");
+        }
+
+        else if (!strcmp(argv[i], "--record-input")) {
+            if (i + 1 < argc) record_input = argv[++i];
+            else terminate_with_error("Missing value for --record-input");
+        }
     }
 
     uint32_t scale;
@@ -78,16 +274,59 @@ int main(int argc, char *argv[]) {
         theme = DEFAULT_THEME;
     }
 
+    QuirkProfile profile = DEFAULT_QUIRK_PROFILE;
+    if (profile_str != NULL && quirk_profile_from_str(profile_str, &profile) != 0) {
+        exit(1);
+    }
+
     int cpu_clock = (clock_str != NULL)? cpu_clock_from_str(clock_str): DEFAULT_CPU_CLOCK;
 
+    if (headless && (capture_video || capture_audio) && !max_frames)
+        terminate_with_error("--headless capture never ends by itself, give the length with --frames");
+    if (stream && capture_video && !strcmp(stream, "-") && !strcmp(capture_video, "-"))
+        terminate_with_error("--stream and --capture-video can't both use stdout");
+    if (latency && (threaded || headless))
+        terminate_with_error("--latency needs the keyboard and display on the emulation thread, not --threaded or --headless");
+    if (wall && headless)
+        terminate_with_error("--wall needs a window, it can't run --headless");
+    if (term && (headless || wall || threaded))
+        terminate_with_error("--term draws one instance in the terminal, not with --headless, --wall or --threaded");
+
     Config config;
     config.program_filename = filename;
     config.theme = theme;
     config.scale = scale;
     config.cpu_clock = cpu_clock;
     config.muted = muted;
+    config.profile = profile;
+    config.timing = timing;
+    config.stats = stats;
+    config.stats_file = stats_file;
+    config.stats_overlay = stats_overlay;
+    config.headless = headless;
+    config.max_frames = max_frames;
+    config.capture_video = capture_video;
+    config.capture_audio = capture_audio;
+    config.capture_format = capture_format;
+    config.input_script = input_script;
+    config.record_input = record_input;
+    config.turbo = turbo;
+    config.run_ahead = run_ahead;
+    config.threaded = threaded;
+    config.phosphor = phosphor;
+    config.stream = stream;
+    config.startup_trace = startup_trace;
+    config.crt = crt;
+    config.latency = latency;
+    config.wall = wall;
+    config.validate = validate;
+    config.term = term;
+
+    if (config.validate)
+        return validate_run(&config) == 0 ? 0 : 1;
 
-    if (emulate_chip8(config) != 0) {
+    int rc = config.term ? emulate_term(config) : config.wall ? emulate_wall(config) : emulate_chip8(config);
+    if (rc != 0) {
         terminate_with_error("Emulator returned an error");
     }
 
@@ -111,9 +350,10 @@ int scale_from_str(const char *s, uint32_t *out_scale) {
 }
 
 uint64_t cpu_clock_from_str(const char* str) {
-    long val = strtol(str, NULL, 10);
-    if(val < 300 || val > 1000) {
-        fprintf(stderr, "[clock] must be in [300,1000], got \"%s\"\n", str);
+    char *endptr = NULL;
+    long val = strtol(str, &endptr, 10);
+    if(endptr == str || *endptr != '\0' || val < MIN_CPU_CLOCK || val > MAX_CPU_CLOCK) {
+        fprintf(stderr, "[clock] must be in [%d,%d], got \"%s\"\n", MIN_CPU_CLOCK, MAX_CPU_CLOCK, str);
         exit(1);
     }
     return (uint64_t)val;
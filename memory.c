@@ -1,11 +1,18 @@
+#include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
 
 #include "memory.h"
 
-const size_t MEMORY_SIZE = 4096;
-const size_t PROGRAM_START = 0x200;
+#ifdef CHIP8_GUARDED_MEMORY
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#endif
 
 const size_t FONTSET_ADDRESS = 0x000;
 //sprite 4 pixcel width and 5 pixcel tall
@@ -33,29 +40,99 @@ static void load_fontset(uint8_t *mem) {
 }
 
 static int load_program(uint8_t *mem, const uint8_t *program, size_t program_len) {
-    size_t last_address = PROGRAM_START + program_len;
-
-    if (last_address >= MEMORY_SIZE) {
+    if (program_len > PROGRAM_MAX_SIZE) {
         return 1; // error
     }
 
-    memcpy(mem + PROGRAM_START, program, program_len);//copy ROM data
+    if (program_len)
+        memcpy(mem + PROGRAM_START, program, program_len);//copy ROM data
     return 0;
 }
 
+#ifdef CHIP8_GUARDED_MEMORY
+/* RAM with a no-access page on both sides, MEMORY_SIZE is a multiple of the page size */
+static size_t page_size(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwPageSize;
+#else
+    return (size_t)sysconf(_SC_PAGESIZE);
+#endif
+}
+
+static uint8_t *ram_alloc(void) {
+    size_t page = page_size();
+    size_t total = MEMORY_SIZE + 2 * page;
+#ifdef _WIN32
+    uint8_t *base = VirtualAlloc(NULL, total, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    if (!base) return NULL;
+    DWORD old;
+    VirtualProtect(base, page, PAGE_NOACCESS, &old);
+    VirtualProtect(base + page + MEMORY_SIZE, page, PAGE_NOACCESS, &old);
+#else
+    uint8_t *base = mmap(NULL, total, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) return NULL;
+    mprotect(base, page, PROT_NONE);
+    mprotect(base + page + MEMORY_SIZE, page, PROT_NONE);
+#endif
+    return base + page;//zero filled
+}
+
+static void ram_free(uint8_t *mem) {
+    size_t page = page_size();
+#ifdef _WIN32
+    VirtualFree(mem - page, 0, MEM_RELEASE);
+#else
+    munmap(mem - page, MEMORY_SIZE + 2 * page);
+#endif
+}
+#else
+static uint8_t *ram_alloc(void) {
+    return calloc(1, MEMORY_SIZE);
+}
+
+static void ram_free(uint8_t *mem) {
+    free(mem);
+}
+#endif
+
 int memory_new(Memory *m, const uint8_t *program, size_t program_len) {
-    m->mem = malloc(MEMORY_SIZE);
+    m->mem = ram_alloc();//zero filled
     if (!m->mem) return 1;
-
-    memset(m->mem, 0, MEMORY_SIZE);
+    memory_clear_dirty(m);
+    m->track_dirty = false;
 
     load_fontset(m->mem);//copy font to RAM
 
     if (load_program(m->mem, program, program_len) != 0) {//copy ROM data to RAM
-        free(m->mem);
+        ram_free(m->mem);
         m->mem = NULL;
         return 1;
     }
 
     return 0;
 }
+
+void memory_free(Memory *m) {
+    if (!m || !m->mem) return;
+    ram_free(m->mem);
+    m->mem = NULL;
+}
+
+uint8_t *memory_read_rom(const char *path, size_t *size) {
+    *size = 0;
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+    long len = fseek(f, 0, SEEK_END) == 0 ? ftell(f) : -1;
+    uint8_t *data = NULL;
+    if (len >= 0 && len <= MEMORY_SIZE && fseek(f, 0, SEEK_SET) == 0)//bigger can't be a ROM (or is a directory)
+        data = malloc(len > 0 ? (size_t)len : 1);//an empty ROM is still a buffer
+    if (data && fread(data, 1, (size_t)len, f) != (size_t)len) {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+    if (data) *size = (size_t)len;
+    return data;
+}
@@ -3,9 +3,36 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <stdbool.h>
+
+#define MEMORY_SIZE 0x10000 //64KB, XO-CHIP address space (CHIP-8 programs only use the first 4KB)
+#define MEMORY_MASK (MEMORY_SIZE - 1) //addresses wrap around at the end of memory
+#define PROGRAM_START 0x200
+#define PROGRAM_MAX_SIZE (MEMORY_SIZE - PROGRAM_START - 1) //largest ROM memory_new loads
 
 typedef struct {
     uint8_t *mem;
+    uint32_t dirty_lo, dirty_hi;//bytes [dirty_lo, dirty_hi) written by the CPU since the last memory_clear_dirty
+    bool track_dirty;//set by snapshot_save, until then the CPU doesn't keep the dirty range
 } Memory;
+
+/*
+ * Build with CHIP8_GUARDED_MEMORY to place an inaccessible page right before and after the
+ * 64KB of RAM, so any access outside of it traps at once (fuzzing, sanitizer-free debugging).
+ */
 int memory_new(Memory *m, const uint8_t *program, size_t program_len);
+void memory_free(Memory *m);
+/* The whole ROM file in a malloc'ed buffer and its size, NULL if it can't be opened,
+   read completely or is larger than MEMORY_SIZE */
+uint8_t *memory_read_rom(const char *path, size_t *size);
+
+static inline void memory_clear_dirty(Memory *m) {
+    m->dirty_lo = MEMORY_SIZE;
+    m->dirty_hi = 0;
+}
+
+static inline void memory_mark_dirty(Memory *m, uint32_t lo, uint32_t hi) {
+    if (lo < m->dirty_lo) m->dirty_lo = lo;
+    if (hi > m->dirty_hi) m->dirty_hi = hi;
+}
 #endif
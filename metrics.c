@@ -0,0 +1,156 @@
+#include "metrics.h"
+#include <string.h>
+
+#define STATS_INTERVAL_FRAMES 300 //stderr line every 5 seconds
+#define FRAME_NS 16666667ULL
+
+static const char *const METRIC_NAMES[METRIC_COUNT] = {
+    "instr", "cpu_us", "display_us", "input_us", "sleep_us", "overshoot_us"
+};
+
+static uint32_t bucket_of(uint64_t v) {
+    uint32_t b = 0;
+    while (v && b < HIST_BUCKETS - 1) {//position of the highest set bit + 1
+        v >>= 1;
+        b++;
+    }
+    return b;
+}
+
+void histogram_add(Histogram *h, uint64_t v) {
+    h->counts[bucket_of(v)]++;
+    h->samples++;
+    h->sum += v;
+    if (v > h->max)
+        h->max = v;
+}
+
+uint64_t histogram_percentile(const Histogram *h, uint32_t p) {
+    if (h->samples == 0)
+        return 0;
+    uint64_t want = (h->samples * p + 99) / 100;
+    uint64_t seen = 0;
+    for (uint32_t b = 0; b < HIST_BUCKETS; b++) {
+        seen += h->counts[b];
+        if (seen >= want) {
+            uint64_t upper = (b == 0) ? 0 : ((1ULL << b) - 1);
+            return upper < h->max ? upper : h->max;
+        }
+    }
+    return h->max;
+}
+
+int metrics_init(Metrics *m, bool print_stats, const char *csv_path, bool overlay) {
+    memset(m, 0, sizeof(*m));
+    m->print_stats = print_stats;
+    m->overlay = overlay;
+    m->stats_interval = STATS_INTERVAL_FRAMES;
+
+    if (csv_path) {
+        m->csv = fopen(csv_path, "w");
+        if (!m->csv) {
+            fprintf(stderr, "Failed to create stats file: %s\n", csv_path);
+            return 1;
+        }
+        fprintf(m->csv, "frame,instructions,cpu_ns,display_ns,input_ns,sleep_ns,overshoot_ns,missed,idle\n");
+    }
+    m->enabled = print_stats || overlay || m->csv;
+    return 0;
+}
+
+static void print_stats_line(Metrics *m) {
+    fprintf(stderr, "[stats] frames=%llu missed=%llu idle=%llu",
+            (unsigned long long)m->frames, (unsigned long long)m->window_missed, (unsigned long long)m->window_idle);
+    for (int id = 0; id < METRIC_COUNT; id++) {
+        const Histogram *h = &m->window[id];
+        fprintf(stderr, " %s(avg/p50/p99/max)=%llu/%llu/%llu/%llu", METRIC_NAMES[id],
+                (unsigned long long)(h->samples ? h->sum / h->samples : 0),
+                (unsigned long long)histogram_percentile(h, 50),
+                (unsigned long long)histogram_percentile(h, 99),
+                (unsigned long long)h->max);
+    }
+    fprintf(stderr, "\n");
+}
+
+void metrics_record(Metrics *m, const FrameSample *sample) {
+    if (!m->enabled)
+        return;
+
+    m->last = *sample;
+    m->frames++;
+    if (sample->missed) {
+        m->missed_frames++;
+        m->window_missed++;
+    }
+    if (sample->idle)
+        m->window_idle++;
+
+    /* Histograms count instructions as is and durations in microseconds */
+    for (int id = 0; id < METRIC_COUNT; id++)
+        histogram_add(&m->window[id], (id == METRIC_INSTRUCTIONS) ? sample->values[id] : sample->values[id] / 1000);
+
+    if (m->csv) {
+        fprintf(m->csv, "%llu,%llu,%llu,%llu,%llu,%llu,%llu,%d,%d\n",
+                (unsigned long long)m->frames,
+                (unsigned long long)sample->values[METRIC_INSTRUCTIONS],
+                (unsigned long long)sample->values[METRIC_CPU],
+                (unsigned long long)sample->values[METRIC_DISPLAY],
+                (unsigned long long)sample->values[METRIC_INPUT],
+                (unsigned long long)sample->values[METRIC_SLEEP],
+                (unsigned long long)sample->values[METRIC_OVERSHOOT],
+                sample->missed ? 1 : 0,
+                sample->idle ? 1 : 0);
+    }
+
+    if (m->print_stats && m->frames % m->stats_interval == 0) {
+        print_stats_line(m);
+        memset(m->window, 0, sizeof(m->window));
+        m->window_missed = 0;
+        m->window_idle = 0;
+    }
+}
+
+/*
+ * One horizontal bar per timed metric, full window width = one 60Hz frame (16.7msec).
+ * cpu = red, display = green, input = blue, sleep = grey, overshoot = yellow.
+ * A red strip on the left edge marks a missed frame.
+ */
+void metrics_render_overlay(const Metrics *m, SDL_Renderer *renderer) {
+    static const SDL_Color COLORS[METRIC_COUNT] = {
+        {0, 0, 0, 0}, {255, 64, 64, 200}, {64, 255, 64, 200},
+        {64, 128, 255, 200}, {160, 160, 160, 200}, {255, 255, 0, 200}
+    };
+    if (!m->overlay || !renderer)
+        return;
+
+    int w, h;
+    SDL_GetRendererOutputSize(renderer, &w, &h);
+    int bar_h = h / 40 > 2 ? h / 40 : 2;
+
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+    for (int id = METRIC_CPU; id < METRIC_COUNT; id++) {
+        uint64_t ns = m->last.values[id];
+        SDL_Rect r;
+        r.x = 0;
+        r.y = (id - METRIC_CPU) * (bar_h + 1);
+        r.w = (int)((ns > FRAME_NS ? FRAME_NS : ns) * (uint64_t)w / FRAME_NS);
+        r.h = bar_h;
+        SDL_SetRenderDrawColor(renderer, COLORS[id].r, COLORS[id].g, COLORS[id].b, COLORS[id].a);
+        SDL_RenderFillRect(renderer, &r);
+    }
+    if (m->last.missed) {
+        SDL_Rect r = {0, 0, bar_h, h};
+        SDL_SetRenderDrawColor(renderer, 255, 0, 0, 255);
+        SDL_RenderFillRect(renderer, &r);
+    }
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+}
+
+void metrics_shutdown(Metrics *m) {
+    if (m->print_stats && m->frames % m->stats_interval != 0)
+        print_stats_line(m);//partial window
+    if (m->csv) {
+        fclose(m->csv);
+        m->csv = NULL;
+    }
+}
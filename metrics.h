@@ -0,0 +1,63 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "SDL.h"
+
+/* Per frame measurements, instructions is a count, everything else is in nanoseconds */
+typedef enum {
+    METRIC_INSTRUCTIONS,
+    METRIC_CPU,       //cpu_cycle / cpu_run_frame
+    METRIC_DISPLAY,   //display_draw (includes vsync wait in SDL_RenderPresent)
+    METRIC_INPUT,     //input_poll
+    METRIC_SLEEP,     //time actually slept
+    METRIC_OVERSHOOT, //slept longer than asked for (OS scheduler)
+    METRIC_COUNT
+} MetricId;
+
+/* log2 buckets: bucket 0 holds 0, bucket b holds [2^(b-1), 2^b) microseconds (or instructions),
+   the last bucket holds everything above */
+#define HIST_BUCKETS 24
+
+typedef struct {
+    uint32_t counts[HIST_BUCKETS];
+    uint64_t samples;
+    uint64_t sum;
+    uint64_t max;
+} Histogram;
+
+void histogram_add(Histogram *h, uint64_t v);
+/* Upper bound of the bucket holding the p-th percentile (never above the real max) */
+uint64_t histogram_percentile(const Histogram *h, uint32_t p);
+
+typedef struct {
+    uint64_t values[METRIC_COUNT];
+    bool missed;//frame work finished after its 60Hz deadline
+    bool idle;//CPU ended the frame in a polling loop (cpu.idle)
+} FrameSample;
+
+typedef struct {
+    bool enabled;
+    bool print_stats;//periodic line on stderr
+    bool overlay;//bars drawn over the frame
+    FILE *csv;//one row per frame
+    uint32_t stats_interval;//frames between two stderr lines
+
+    uint64_t frames;
+    uint64_t missed_frames;
+    Histogram window[METRIC_COUNT];//since last stderr line
+    uint64_t window_missed;
+    uint64_t window_idle;
+    FrameSample last;
+} Metrics;
+
+/* Returns 0 on success, non-zero if the CSV file can't be created */
+int metrics_init(Metrics *m, bool print_stats, const char *csv_path, bool overlay);
+void metrics_record(Metrics *m, const FrameSample *sample);
+/* Draw the last frame's timing as bars on top of the current frame (before SDL_RenderPresent) */
+void metrics_render_overlay(const Metrics *m, SDL_Renderer *renderer);
+void metrics_shutdown(Metrics *m);
+
+#endif /* METRICS_H */
@@ -0,0 +1,118 @@
+#include "replay.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+static int load_script(Replay *r, const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "Failed to open input script: %s\n", path);
+        return 1;
+    }
+
+    size_t cap = 0;
+    char line[128];
+    int line_no = 0;
+    while (fgets(line, sizeof(line), f)) {
+        line_no++;
+        char *p = line;
+        while (*p == ' ' || *p == '\t') p++;
+        if (*p == '#' || *p == '\n' || *p == '\r' || *p == '\0')
+            continue;
+
+        char *end = NULL;
+        errno = 0;
+        unsigned long long frame = strtoull(p, &end, 10);
+        if (end == p || errno) goto bad_line;
+        p = end;
+        unsigned long keys = strtoul(p, &end, 16);
+        if (end == p || keys > 0xFFFF) goto bad_line;
+        if (r->count && frame < r->events[r->count - 1].frame) {
+            fprintf(stderr, "[input-script] %s:%d frames must increase\n", path, line_no);
+            fclose(f);
+            return 1;
+        }
+
+        if (r->count == cap) {
+            cap = cap ? cap * 2 : 64;
+            ReplayEvent *grown = realloc(r->events, cap * sizeof(*grown));
+            if (!grown) {
+                fclose(f);
+                return 1;
+            }
+            r->events = grown;
+        }
+        r->events[r->count].frame = frame;
+        r->events[r->count].keys = (uint16_t)keys;
+        r->count++;
+        continue;
+
+    bad_line:
+        fprintf(stderr, "[input-script] %s:%d expected \"<frame> <hex keys>\"\n", path, line_no);
+        fclose(f);
+        return 1;
+    }
+    fclose(f);
+    return 0;
+}
+
+static int open_recording(Replay *r) {
+    r->record = fopen(r->record_path, "w");
+    if (!r->record) {
+        fprintf(stderr, "Failed to open input recording: %s\n", r->record_path);
+        return 1;
+    }
+    fprintf(r->record, "# chip8 input recording: <frame> <hex keys>\n");
+    r->recorded = -1;
+    return 0;
+}
+
+int replay_open(Replay *r, const char *play_path, const char *record_path) {
+    memset(r, 0, sizeof(*r));
+    r->recorded = -1;
+
+    if (play_path && load_script(r, play_path) != 0) {
+        replay_close(r);
+        return 1;
+    }
+    if (record_path) {
+        r->record_path = record_path;
+        if (open_recording(r) != 0) {
+            replay_close(r);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+uint16_t replay_keys(Replay *r, uint64_t frame) {
+    while (r->next < r->count && r->events[r->next].frame <= frame)
+        r->keys = r->events[r->next++].keys;
+    return r->keys;
+}
+
+void replay_record(Replay *r, uint64_t frame, uint16_t keys) {
+    if (!r->record || r->recorded == keys)
+        return;
+    fprintf(r->record, "%llu %04x\n", (unsigned long long)frame, keys);
+    r->recorded = keys;
+}
+
+void replay_rewind(Replay *r) {
+    r->next = 0;
+    r->keys = 0;
+    if (r->record) {
+        fclose(r->record);
+        open_recording(r);
+    }
+}
+
+void replay_close(Replay *r) {
+    free(r->events);
+    r->events = NULL;
+    r->count = 0;
+    if (r->record) {
+        fclose(r->record);
+        r->record = NULL;
+    }
+}
@@ -0,0 +1,39 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/*
+ * Recorded keypad input, one line per change:
+ *   <frame> <keys>
+ * keys is the keypad as hex bits (bit k = key k pressed), valid from that frame until the next line.
+ * Lines starting with '#' are comments. Frames count from 0 like the emulator's frame loop.
+ */
+typedef struct {
+    uint64_t frame;
+    uint16_t keys;
+} ReplayEvent;
+
+typedef struct {
+    ReplayEvent *events;//playback script, NULL if none
+    size_t count;
+    size_t next;//next event to apply
+    uint16_t keys;//keypad at the current playback frame
+    FILE *record;//recording output, NULL if none
+    const char *record_path;
+    int recorded;//last keys written, -1 before the first line
+} Replay;
+
+/* Both paths are optional (NULL). Returns 0 on success */
+int replay_open(Replay *r, const char *play_path, const char *record_path);
+/* Keypad for 'frame', frames must be asked in increasing order */
+uint16_t replay_keys(Replay *r, uint64_t frame);
+/* Append a line if the keypad changed since the last recorded frame */
+void replay_record(Replay *r, uint64_t frame, uint16_t keys);
+/* Restart playback from frame 0, the recording restarts too so it always matches the latest run */
+void replay_rewind(Replay *r);
+void replay_close(Replay *r);
+
+#endif
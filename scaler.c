@@ -0,0 +1,174 @@
+#include "scaler.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#include <immintrin.h>
+#define HAVE_X86_SCALER 1
+#endif
+
+#define CRT_MIN_SCALE 3 //smaller pixels have no room for a mask
+#define CRT_GRILLE 180 //the two other channels of an aperture grille column, /256
+#define CRT_SCANLINE 140 //last output row of every pixel row, /256
+
+/* Phosphor: h += (f - h) * k / 128 per byte, rounded away from h so it always reaches f.
+   |f - h| * k <= 255 * 128 fits the signed 16 bit lanes of the SIMD versions. */
+static void phosphor_scalar(uint8_t *h, const uint8_t *f, size_t bytes, int k) {
+    for (size_t i = 0; i < bytes; i++) {
+        int d = f[i] - h[i];
+        h[i] = (uint8_t)(h[i] + ((d * k + (d > 0 ? 127 : 0)) >> 7));
+    }
+}
+
+/* CRT: dst = src * mask / 256 per byte */
+static void mask_scalar(uint8_t *dst, const uint8_t *src, const uint16_t *mask, size_t bytes) {
+    for (size_t i = 0; i < bytes; i++)
+        dst[i] = (uint8_t)((src[i] * mask[i]) >> 8);
+}
+
+#ifdef HAVE_X86_SCALER
+__attribute__((target("sse2")))
+static void phosphor_sse2(uint8_t *h, const uint8_t *f, size_t bytes, int k) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i vk = _mm_set1_epi16((short)k);
+    const __m128i round = _mm_set1_epi16(127);
+
+    for (size_t i = 0; i < bytes; i += 16) {
+        __m128i hv = _mm_loadu_si128((const __m128i *)(h + i));
+        __m128i fv = _mm_loadu_si128((const __m128i *)(f + i));
+        __m128i hl = _mm_unpacklo_epi8(hv, zero), hh = _mm_unpackhi_epi8(hv, zero);
+        __m128i dl = _mm_sub_epi16(_mm_unpacklo_epi8(fv, zero), hl);
+        __m128i dh = _mm_sub_epi16(_mm_unpackhi_epi8(fv, zero), hh);
+        dl = _mm_add_epi16(_mm_mullo_epi16(dl, vk), _mm_and_si128(_mm_cmpgt_epi16(dl, zero), round));
+        dh = _mm_add_epi16(_mm_mullo_epi16(dh, vk), _mm_and_si128(_mm_cmpgt_epi16(dh, zero), round));
+        hl = _mm_add_epi16(hl, _mm_srai_epi16(dl, 7));
+        hh = _mm_add_epi16(hh, _mm_srai_epi16(dh, 7));
+        _mm_storeu_si128((__m128i *)(h + i), _mm_packus_epi16(hl, hh));
+    }
+}
+
+__attribute__((target("sse2")))
+static void mask_sse2(uint8_t *dst, const uint8_t *src, const uint16_t *mask, size_t bytes) {
+    const __m128i zero = _mm_setzero_si128();
+
+    for (size_t i = 0; i < bytes; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i lo = _mm_mullo_epi16(_mm_unpacklo_epi8(v, zero), _mm_loadu_si128((const __m128i *)(mask + i)));
+        __m128i hi = _mm_mullo_epi16(_mm_unpackhi_epi8(v, zero), _mm_loadu_si128((const __m128i *)(mask + i + 8)));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(_mm_srli_epi16(lo, 8), _mm_srli_epi16(hi, 8)));
+    }
+}
+
+/* 32 bytes at a time: widen each half in order (no in-lane unpack), packus interleaves the
+   128 bit lanes so they are put back in order with one permute */
+__attribute__((target("avx2")))
+static void mask_avx2(uint8_t *dst, const uint8_t *src, const uint16_t *mask, size_t bytes) {
+    for (size_t i = 0; i < bytes; i += 32) {
+        __m256i lo = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(src + i)));
+        __m256i hi = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(src + i + 16)));
+        lo = _mm256_srli_epi16(_mm256_mullo_epi16(lo, _mm256_loadu_si256((const __m256i *)(mask + i))), 8);
+        hi = _mm256_srli_epi16(_mm256_mullo_epi16(hi, _mm256_loadu_si256((const __m256i *)(mask + i + 16))), 8);
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), 0xD8));
+    }
+}
+#endif
+
+typedef void (*PhosphorFn)(uint8_t *h, const uint8_t *f, size_t bytes, int k);
+typedef void (*MaskFn)(uint8_t *dst, const uint8_t *src, const uint16_t *mask, size_t bytes);
+
+static PhosphorFn phosphor = phosphor_scalar;
+static MaskFn mask_row = mask_scalar;
+
+static void select_simd(void) {
+#ifdef HAVE_X86_SCALER
+    if (__builtin_cpu_supports("sse2")) {
+        phosphor = phosphor_sse2;
+        mask_row = mask_sse2;
+    }
+    if (__builtin_cpu_supports("avx2"))
+        mask_row = mask_avx2;
+#endif
+}
+
+int scaler_init(Scaler *s, uint32_t scale, uint32_t phosphor_percent, bool crt) {
+    memset(s, 0, sizeof(*s));
+    s->scale = scale;
+    s->keep = (uint16_t)(phosphor_percent * 128 / 100);
+    s->crt = crt;
+    select_simd();
+    if (!crt)
+        return 0;
+
+    /* Row lengths are SCREEN_WIDTH * scale * 4 bytes, always a multiple of 32 for the SIMD loops */
+    size_t width = (size_t)SCREEN_WIDTH * scale;
+    s->line = malloc(width * sizeof(uint32_t));
+    s->mask[0] = malloc(width * 4 * sizeof(uint16_t));
+    s->mask[1] = malloc(width * 4 * sizeof(uint16_t));
+    if (!s->line || !s->mask[0] || !s->mask[1]) {
+        scaler_free(s);
+        return 1;
+    }
+    for (size_t x = 0; x < width; x++) {
+        for (int ch = 0; ch < 4; ch++) {//ARGB8888 in memory: B, G, R, A
+            uint16_t m = 256;
+            if (scale >= CRT_MIN_SCALE && ch != 3 && ch != 2 - (int)(x % 3))
+                m = CRT_GRILLE;//column x lets only R, G or B through at full strength
+            s->mask[0][x * 4 + ch] = m;
+            s->mask[1][x * 4 + ch] = (scale >= CRT_MIN_SCALE && ch != 3) ? (uint16_t)(m * CRT_SCANLINE / 256) : m;
+        }
+    }
+    return 0;
+}
+
+void scaler_free(Scaler *s) {
+    free(s->line);
+    free(s->mask[0]);
+    free(s->mask[1]);
+    s->line = NULL;
+    s->mask[0] = s->mask[1] = NULL;
+}
+
+uint32_t scaler_width(const Scaler *s) {
+    return s->crt ? SCREEN_WIDTH * s->scale : SCREEN_WIDTH;
+}
+
+uint32_t scaler_height(const Scaler *s) {
+    return s->crt ? SCREEN_HEIGHT * s->scale : SCREEN_HEIGHT;
+}
+
+void scaler_run(Scaler *s, uint32_t *dst, int dst_pitch) {
+    const uint32_t *src = s->frame;
+    if (s->keep) {
+        if (s->primed)
+            phosphor((uint8_t *)s->history, (const uint8_t *)s->frame, sizeof(s->history), 128 - s->keep);
+        else
+            memcpy(s->history, s->frame, sizeof(s->history));//nothing to fade from yet
+        s->primed = true;
+        src = s->history;
+    }
+
+    if (!s->crt) {
+        for (size_t y = 0; y < SCREEN_HEIGHT; y++)
+            memcpy((uint8_t *)dst + y * (size_t)dst_pitch, src + y * SCREEN_WIDTH, SCREEN_WIDTH * sizeof(uint32_t));
+        return;
+    }
+
+    /* Every output row of a pixel row is the same scaled line times one of the two masks:
+       multiply once per mask, copy the rest */
+    size_t scale = s->scale;
+    size_t bytes = SCREEN_WIDTH * scale * sizeof(uint32_t);
+    for (size_t y = 0; y < SCREEN_HEIGHT; y++) {
+        const uint32_t *row = src + y * SCREEN_WIDTH;
+        uint32_t *l = s->line;
+        for (size_t x = 0; x < SCREEN_WIDTH; x++)
+            for (size_t k = 0; k < scale; k++)
+                *l++ = row[x];
+
+        uint8_t *out = (uint8_t *)dst + y * scale * (size_t)dst_pitch;
+        mask_row(out, (const uint8_t *)s->line, s->mask[0], bytes);
+        for (size_t r = 1; r + 1 < scale; r++)
+            memcpy(out + r * (size_t)dst_pitch, out, bytes);
+        if (scale > 1)
+            mask_row(out + (scale - 1) * (size_t)dst_pitch, (const uint8_t *)s->line, s->mask[1], bytes);
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef SCALER_H
+#define SCALER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "vmemory.h"
+
+/*
+ * CPU post-processing of the composited 64x32 ARGB8888 frame, no SDL needed.
+ *   phosphor: every frame the shown picture moves only part of the way towards the new frame,
+ *             so XOR flicker (sprites erased and redrawn every frame) becomes a steady image
+ *   crt:      nearest neighbor scale by 'scale' with an aperture grille and dark scanlines
+ * The per byte work is SSE2/AVX2 when the CPU has it, with a scalar fallback.
+ */
+#define MAX_PHOSPHOR 95 //percent of the old picture kept per frame
+
+typedef struct {
+    uint32_t scale;
+    uint16_t keep;//phosphor: old picture kept per frame in 1/128, 0 = off
+    bool crt;
+    bool primed;//history holds a frame
+    uint32_t frame[SCREEN_WIDTH * SCREEN_HEIGHT];//composited input, filled by the caller
+    uint32_t history[SCREEN_WIDTH * SCREEN_HEIGHT];//picture shown last, phosphor only
+    uint32_t *line;//crt: one source row scaled horizontally
+    uint16_t *mask[2];//crt: per byte multiplier (/256) of a normal and of a scanline output row
+} Scaler;
+
+/* Returns 0 on success, non-zero if out of memory */
+int scaler_init(Scaler *s, uint32_t scale, uint32_t phosphor_percent, bool crt);
+void scaler_free(Scaler *s);
+
+/* Output size: SCREEN_WIDTH x SCREEN_HEIGHT, times scale with crt */
+uint32_t scaler_width(const Scaler *s);
+uint32_t scaler_height(const Scaler *s);
+
+/* Process s->frame into dst (scaler_width x scaler_height pixels, 'dst_pitch' bytes per row) */
+void scaler_run(Scaler *s, uint32_t *dst, int dst_pitch);
+
+#endif /* SCALER_H */
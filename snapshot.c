@@ -0,0 +1,39 @@
+#include "snapshot.h"
+#include <stdlib.h>
+#include <string.h>
+
+int snapshot_init(Snapshot *s) {
+    memset(&s->cpu, 0, sizeof(s->cpu));
+    s->synced = false;
+    s->mem = malloc(MEMORY_SIZE);
+    return s->mem ? 0 : 1;
+}
+
+void snapshot_save(Snapshot *s, Cpu *c) {
+    Memory *m = &c->memory;
+    if (s->synced && m->track_dirty && s->cpu.memory.mem == m->mem) {
+        if (m->dirty_lo < m->dirty_hi)
+            memcpy(s->mem + m->dirty_lo, m->mem + m->dirty_lo, m->dirty_hi - m->dirty_lo);
+    } else {
+        memcpy(s->mem, m->mem, MEMORY_SIZE);//first save, or writes that weren't tracked (new Memory)
+    }
+    memory_clear_dirty(m);
+    m->track_dirty = true;
+    s->cpu = *c;
+    s->synced = true;
+}
+
+void snapshot_restore(const Snapshot *s, Cpu *c) {
+    Memory memory = c->memory;
+    if (memory.dirty_lo < memory.dirty_hi)
+        memcpy(memory.mem + memory.dirty_lo, s->mem + memory.dirty_lo, memory.dirty_hi - memory.dirty_lo);
+
+    *c = s->cpu;
+    c->memory.mem = memory.mem;
+    memory_clear_dirty(&c->memory);
+}
+
+void snapshot_free(Snapshot *s) {
+    free(s->mem);
+    s->mem = NULL;
+}
@@ -0,0 +1,26 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdint.h>
+#include "cpu.h"
+
+/*
+ * Complete machine state: registers, stack, timers, video memory and the 64KB of RAM.
+ * Both directions copy only the RAM the CPU wrote since the last save or restore (usually a few
+ * bytes instead of 64KB): snapshot_restore copies that range back, and the next snapshot_save
+ * copies just that range in. The first save of a Cpu copies all of it.
+ * The CPU only keeps that range after its first snapshot_save, runs without snapshots don't pay for it.
+ * Use one Snapshot per Cpu and restore into the Cpu that was saved, its Memory buffer stays its own.
+ */
+typedef struct {
+    Cpu cpu;
+    uint8_t *mem;//MEMORY_SIZE bytes
+    bool synced;//mem equals the CPU's RAM outside its dirty range, the next save can be partial
+} Snapshot;
+
+int snapshot_init(Snapshot *s);
+void snapshot_save(Snapshot *s, Cpu *c);
+void snapshot_restore(const Snapshot *s, Cpu *c);
+void snapshot_free(Snapshot *s);
+
+#endif
@@ -2,11 +2,61 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
+#include <math.h>
 
 void init_sound(SoundHandler *sound, bool muted) {
     fprintf(stdout, "init_source");
 }
 
+/* Fill 'samples' float samples [-1,1] from the square wave, or from the XO-CHIP pattern once loaded */
+void sound_synthesize(SquareWave *wave, PatternWave *pattern, float *out, int samples)
+{
+    if (pattern->enabled) {//XO-CHIP pattern playback
+        PatternWave *p = pattern;
+        for (int i = 0; i < samples; i++) {
+            int bit = (int)p->phase;//0..127
+            int on = (p->bits[bit >> 3] >> (7 - (bit & 7))) & 1;//MSB first
+            out[i] = p->volume * (on ? 1.0f : -1.0f);
+
+            p->phase += p->phase_inc;
+            if (p->phase >= 128.0f)
+                p->phase -= 128.0f;
+        }
+        return;
+    }
+
+    for (int i = 0; i < samples; i++) {
+        out[i] = wave->volume *
+                 ((wave->phase <= 0.5f) ? 1.0f : -1.0f);//Flat top = phase ≤ 0.5; Flat bottom = phase > 0.5
+
+        wave->phase += wave->phase_inc;
+        if (wave->phase >= 1.0f)
+            wave->phase -= 1.0f;
+    }//0.00 → 0.04 → 0.08 → ... → 0.48 → 0.52 → ... → 0.96 → wrap
+}
+
+void sound_waves_init(SquareWave *wave, PatternWave *pattern, int freq)
+{
+    // Initialize square wave generator
+    wave->phase_inc = 440.0f / (float)freq;//440Hz A4 note, freq=11025Hz; Phase advanced per sample is 0.0399
+    wave->phase = 0.0f;//[0->0.04->0.08->..1] one full wavecycle is ~25samples 
+    wave->volume = 0.5f;//volume 50%
+
+    memset(pattern, 0, sizeof(*pattern));
+    pattern->volume = wave->volume;
+}
+
+/* XO-CHIP F002/Fx3A: switch to pattern playback, rate = 4000 * 2^((pitch - 64) / 48) bits per second */
+void sound_pattern_load(PatternWave *p, const uint8_t pattern[16], uint8_t pitch, int freq)
+{
+    float rate = 4000.0f * powf(2.0f, ((float)pitch - 64.0f) / 48.0f);
+
+    memcpy(p->bits, pattern, sizeof(p->bits));
+    p->phase_inc = rate / (float)freq;
+    p->enabled = true;
+}
+
 static void audio_callback(void *userdata, Uint8 *stream, int len_bytes)
 {
     SoundHandler *s = (SoundHandler *)userdata;
@@ -14,24 +64,36 @@ static void audio_callback(void *userdata, Uint8 *stream, int len_bytes)
 
     int samples = len_bytes / sizeof(float);//len_bytes is sizeof stream buffer in bytes, samples are number of frames(64)
 
-    for (int i = 0; i < samples; i++) {
-        out[i] = s->wave.volume *
-                 ((s->wave.phase <= 0.5f) ? 1.0f : -1.0f);//Flat top = phase ≤ 0.5; Flat bottom = phase > 0.5
-
-        s->wave.phase += s->wave.phase_inc;
-        if (s->wave.phase >= 1.0f)
-            s->wave.phase -= 1.0f;
-    }//0.00 → 0.04 → 0.08 → ... → 0.48 → 0.52 → ... → 0.96 → wrap
+    sound_synthesize(&s->wave, &s->pattern, out, samples);
 }
 
 SoundHandler *sound_create(SoundHandler *s, int muted)
 {
     s->muted = muted;
+    s->device = 0;
+    s->open_failed = false;
+    s->freq = SOUND_SAMPLE_RATE;//until the device tells otherwise
+    sound_waves_init(&s->wave, &s->pattern, s->freq);
+    return s;
+}
+
+/* Start the audio subsystem and open the device, returns false if there is no audio */
+static bool sound_open(SoundHandler *s)
+{
+    if (s->device)
+        return true;
+    if (s->muted || s->open_failed)
+        return false;
+    if (SDL_InitSubSystem(SDL_INIT_AUDIO) != 0) {
+        fprintf(stderr, "SDL audio init failed: %s\n", SDL_GetError());
+        s->open_failed = true;
+        return false;
+    }
 
     SDL_AudioSpec want, have;
     SDL_zero(want);
 
-    want.freq = 11025;//Sampling rate 11025Hz, good for emulator simple sound low quality
+    want.freq = SOUND_SAMPLE_RATE;//Sampling rate 11025Hz, good for emulator simple sound low quality
     want.format = AUDIO_F32; //Auto sampling format float -1 to +1, use AUDIO_S16 for signed 16 bit
     want.samples = 512;//Audio buffer size
     want.callback = audio_callback;//SDL call this function to ask for auto samples
@@ -39,31 +101,57 @@ SoundHandler *sound_create(SoundHandler *s, int muted)
 
     //SDL request OS to get audio device, try to match with want spec.have actual format returned
     s->device = SDL_OpenAudioDevice(NULL, 0, &want, &have, 0);
+    if (!s->device) {
+        fprintf(stderr, "SDL_OpenAudioDevice failed: %s\n", SDL_GetError());
+        s->open_failed = true;
+        return false;
+    }
 
-    // Initialize square wave generator
-    s->wave.phase_inc = 440.0f / (float)have.freq;//440Hz A4 note, freq=11025Hz; Phase advanced per sample is 0.0399
-    s->wave.phase = 0.0f;//[0->0.04->0.08->..1] one full wavecycle is ~25samples 
-    s->wave.volume = 0.5f;//volume 50%
+    if (have.freq != s->freq) {//the waves were set up for SOUND_SAMPLE_RATE, the callback isn't running yet
+        float ratio = (float)s->freq / (float)have.freq;
+        s->wave.phase_inc *= ratio;
+        s->pattern.phase_inc *= ratio;
+        s->freq = have.freq;
+    }
 
     //keep audio device open, but don't play audio. 1->pause (stop callback), 0->resume (start callback)
     SDL_PauseAudioDevice(s->device, 1);
-
-    return s;
+    return true;
 }
 
 void sound_resume(SoundHandler *s)
 {
-    if (!s->muted)
+    if (sound_open(s))
         SDL_PauseAudioDevice(s->device, 0);
 }
 
 void sound_pause(SoundHandler *s)
 {
-    SDL_PauseAudioDevice(s->device, 1);
+    if (s->device)
+        SDL_PauseAudioDevice(s->device, 1);
+}
+
+void sound_close(SoundHandler *s)
+{
+    if (s->device)
+        SDL_CloseAudioDevice(s->device);
+    s->device = 0;
 }
 
 void sound_destroy(SoundHandler *s)
 {
-    SDL_CloseAudioDevice(s->device);
+    sound_close(s);
     free(s);
 }
+
+/* XO-CHIP F002/Fx3A: hand the program's pattern to the audio thread */
+void sound_set_pattern(SoundHandler *s, const uint8_t pattern[16], uint8_t pitch)
+{
+    if (!s->device) {//no audio thread yet
+        sound_pattern_load(&s->pattern, pattern, pitch, s->freq);
+        return;
+    }
+    SDL_LockAudioDevice(s->device);//callback runs on the audio thread
+    sound_pattern_load(&s->pattern, pattern, pitch, s->freq);
+    SDL_UnlockAudioDevice(s->device);
+}
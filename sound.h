@@ -2,6 +2,7 @@
 #define SOUND_H
 
 #include "SDL.h"
+#include <stdint.h>
 #include <stdbool.h>
 
 typedef struct {
@@ -10,15 +11,39 @@ typedef struct {
     float volume;
 } SquareWave;
 
+/* XO-CHIP audio: 128 x 1-bit samples played in a loop at a pitch controlled rate */
 typedef struct {
-    SDL_AudioDeviceID device;
+    uint8_t bits[16];
+    float phase_inc;//pattern bits advanced per output sample
+    float phase;//current bit position [0,128)
+    float volume;
+    bool enabled;//false until the program loads a pattern, square wave is used instead
+} PatternWave;
+
+typedef struct {
+    SDL_AudioDeviceID device;//0 until the first beep opens it (never when muted)
+    bool open_failed;//don't probe again every frame
     int muted;
+    int freq;//output sample rate we got from the device
     SquareWave wave;
+    PatternWave pattern;
 } SoundHandler;
 
+/* No device is opened here: the audio subsystem and device start on the first sound_resume,
+   so a ROM that never beeps (or --mute) never pays for audio device probing */
 SoundHandler *sound_create(SoundHandler *s, int muted);
 void sound_resume(SoundHandler *s);
 void sound_pause(SoundHandler *s);
+/* Close the device of a SoundHandler that isn't heap allocated (sound_destroy also frees it) */
+void sound_close(SoundHandler *s);
 void sound_destroy(SoundHandler *s);
+void sound_set_pattern(SoundHandler *s, const uint8_t pattern[16], uint8_t pitch);
+
+/* Sample generation, shared by the SDL audio callback and offline capture */
+#define SOUND_SAMPLE_RATE 11025
+#define SOUND_HOLD_FRAMES 3 //frames the beeper is kept on, counting the last one of the sound timer (short beeps stay audible)
+void sound_waves_init(SquareWave *wave, PatternWave *pattern, int freq);
+void sound_pattern_load(PatternWave *p, const uint8_t pattern[16], uint8_t pitch, int freq);
+void sound_synthesize(SquareWave *wave, PatternWave *pattern, float *out, int samples);
 void init_sound(SoundHandler *sound, bool muted);
 #endif
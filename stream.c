@@ -0,0 +1,217 @@
+#include "stream.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <unistd.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+/* Worst delta row: changed and unchanged pixels alternate, up to SCREEN_WIDTH / 2 + 1 runs with a
+   (skip, count) header each, plus the XOR bytes of every pixel */
+#define STREAM_MAX_ROW (SCREEN_WIDTH + 2 * (SCREEN_WIDTH / 2 + 1))
+#define STREAM_MAX_MESSAGE (9 + SCREEN_HEIGHT * STREAM_MAX_ROW)
+
+static void put_u32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+#ifndef _WIN32
+static int connect_unix(const char *path) {
+    struct sockaddr_un addr;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "[stream] socket path too long: %s\n", path);
+        return -1;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        perror("[stream] socket");
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        fprintf(stderr, "[stream] can't connect to %s: %s\n", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+#endif
+
+int stream_open(Stream *s, const char *target) {
+    memset(s, 0, sizeof(*s));
+    s->fd = -1;
+    s->in_fd = -1;
+    if (!target)
+        return 0;
+#ifndef _WIN32
+    signal(SIGPIPE, SIG_IGN);//a viewer that goes away makes write() fail with EPIPE instead of killing us
+#endif
+
+    if (!strcmp(target, "-")) {
+#ifdef _WIN32
+        _setmode(1, _O_BINARY);//no CRLF translation of frame data, no input channel on Windows
+#else
+        s->in_fd = 0;
+#endif
+        s->fd = 1;
+        return 0;
+    }
+    if (!strncmp(target, "unix:", 5)) {
+#ifdef _WIN32
+        fprintf(stderr, "[stream] Unix sockets are not supported on this platform, use -\n");
+        return 1;
+#else
+        s->fd = connect_unix(target + 5);
+        if (s->fd < 0)
+            return 1;
+        s->in_fd = s->fd;
+        s->is_socket = true;
+        return 0;
+#endif
+    }
+    fprintf(stderr, "[stream] \"%s\" must be - or unix:<path>\n", target);
+    return 1;
+}
+
+/* One write per message. Returns false (and stops the stream) once the viewer is gone. */
+static bool send_all(Stream *s, const uint8_t *p, size_t n) {
+    while (n > 0) {
+#ifdef _WIN32
+        long w = _write(s->fd, p, (unsigned)n);
+#else
+        ssize_t w = s->is_socket ? send(s->fd, p, n, MSG_NOSIGNAL) : write(s->fd, p, n);
+        if (w < 0 && errno == EINTR)
+            continue;
+#endif
+        if (w <= 0) {
+            fprintf(stderr, "[stream] viewer gone, streaming stopped\n");
+            stream_close(s);
+            return false;
+        }
+        p += w;
+        n -= (size_t)w;
+    }
+    return true;
+}
+
+/* XOR of one row against what the viewer has, as (skip, count, bytes) runs. Returns the length. */
+static size_t encode_row(uint8_t *out, const uint8_t *row, const uint8_t *prev) {
+    size_t n = 0;
+    size_t x = 0;
+    while (x < SCREEN_WIDTH) {
+        size_t skip = x;
+        while (x < SCREEN_WIDTH && row[x] == prev[x])
+            x++;
+        size_t lit = x;
+        while (x < SCREEN_WIDTH && row[x] != prev[x])
+            x++;
+        out[n++] = (uint8_t)(lit - skip);
+        out[n++] = (uint8_t)(x - lit);
+        for (size_t i = lit; i < x; i++)
+            out[n++] = row[i] ^ prev[i];
+    }
+    return n;
+}
+
+void stream_frame(Stream *s, VMemory *vm, uint64_t frame) {
+    if (s->fd < 0)
+        return;
+    uint8_t msg[STREAM_MAX_MESSAGE];
+    size_t n;
+
+    if (!s->keyed || frame == 0) {//first frame, or the emulator restarted
+        msg[0] = STREAM_KEYFRAME;
+        put_u32(msg + 1, (uint32_t)frame);
+        memcpy(msg + 5, vm->buffer, sizeof(vm->buffer));
+        memcpy(s->prev, vm->buffer, sizeof(vm->buffer));
+        vm->dirty_rows = 0;
+        s->keyed = true;
+        send_all(s, msg, 5 + sizeof(vm->buffer));
+        return;
+    }
+
+    uint32_t dirty = vm->dirty_rows;
+    vm->dirty_rows = 0;
+    if (!dirty)
+        return;
+
+    uint32_t rows = 0;
+    n = 9;
+    for (size_t y = 0; y < SCREEN_HEIGHT; y++) {
+        if (!(dirty & (1u << y)))
+            continue;
+        uint8_t *row = vm->buffer + y * SCREEN_WIDTH;
+        uint8_t *prev = s->prev + y * SCREEN_WIDTH;
+        if (!memcmp(row, prev, SCREEN_WIDTH))
+            continue;//drawn twice (XOR) or cleared again, nothing for the viewer
+        n += encode_row(msg + n, row, prev);
+        memcpy(prev, row, SCREEN_WIDTH);
+        rows |= 1u << y;
+    }
+    if (!rows)
+        return;
+    msg[0] = STREAM_DELTA;
+    put_u32(msg + 1, (uint32_t)frame);
+    put_u32(msg + 5, rows);
+    send_all(s, msg, n);
+}
+
+bool stream_keys(Stream *s, uint16_t *bits) {
+#ifndef _WIN32
+    struct pollfd pfd;
+    while (s->in_fd >= 0) {//never blocks, input is picked up once per frame
+        pfd.fd = s->in_fd;
+        pfd.events = POLLIN;
+        if (poll(&pfd, 1, 0) <= 0)
+            break;
+        uint8_t buf[64];
+        ssize_t r = s->is_socket ? recv(s->in_fd, buf, sizeof(buf), 0) : read(s->in_fd, buf, sizeof(buf));
+        if (r <= 0) {
+            if (r == 0)
+                s->in_fd = -1;//viewer closed its side, keep the last keys
+            break;
+        }
+        for (ssize_t i = 0; i < r; i++) {
+            if (s->in_len == 0 && buf[i] != STREAM_INPUT)
+                continue;//not a message start, resynchronize
+            s->in_buf[s->in_len++] = buf[i];
+            if (s->in_len == 3) {
+                s->keys = (uint16_t)(s->in_buf[1] | (s->in_buf[2] << 8));
+                s->has_keys = true;
+                s->in_len = 0;
+            }
+        }
+    }
+#endif
+    if (s->has_keys)
+        *bits = s->keys;
+    return s->has_keys;
+}
+
+void stream_close(Stream *s) {
+#ifndef _WIN32
+    if (s->is_socket && s->fd >= 0)
+        close(s->fd);
+#endif
+    s->fd = -1;
+    if (s->is_socket)
+        s->in_fd = -1;
+    s->is_socket = false;
+}
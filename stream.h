@@ -0,0 +1,50 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "vmemory.h"
+
+/*
+ * --stream: the screen as a compact delta stream for remote viewers of headless instances.
+ * Emulator -> viewer, integers little endian:
+ *   'K' u32 frame, SCREEN_WIDTH*SCREEN_HEIGHT bytes
+ *        keyframe, one byte per pixel (plane bitmask). Sent first and after every restart.
+ *   'D' u32 frame, u32 rows, row data...
+ *        delta, bit y of rows set -> row y follows as the XOR against the previous picture,
+ *        run length coded as (skip u8, count u8, count XOR bytes) until its 64 pixels are covered.
+ *        Only rows the CPU drew to (VMemory.dirty_rows) are compared, frames without a change send nothing.
+ * Viewer -> emulator:
+ *   'I' u16 keypad bits (bit k = key k pressed). From the first one on it replaces the keyboard.
+ */
+#define STREAM_KEYFRAME 'K'
+#define STREAM_DELTA 'D'
+#define STREAM_INPUT 'I'
+
+typedef struct {
+    int fd;//-1 = off
+    int in_fd;//-1 = no input channel
+    bool is_socket;
+    bool keyed;//a keyframe went out, deltas can follow
+    bool has_keys;//the viewer sent input
+    uint16_t keys;
+    uint8_t in_buf[3];//partial input message
+    int in_len;
+    uint8_t prev[SCREEN_WIDTH * SCREEN_HEIGHT];//picture the viewer has
+} Stream;
+
+/* target: NULL = off, "-" = stdout (input on stdin), "unix:<path>" = connect to a viewer's socket.
+ * Returns 0 on success, non-zero on error (and prints an error message).
+ */
+int stream_open(Stream *s, const char *target);
+
+/* Send frame number 'frame' if anything changed, clears vm->dirty_rows.
+   A viewer that goes away stops the stream, the emulator keeps running. */
+void stream_frame(Stream *s, VMemory *vm, uint64_t frame);
+
+/* Latest keypad sent by the viewer. Returns false if it never sent any. */
+bool stream_keys(Stream *s, uint16_t *bits);
+
+void stream_close(Stream *s);
+
+#endif /* STREAM_H */
@@ -0,0 +1,87 @@
+/*
+ * stream.c self check (make stream-test): encodes frames into a pipe, decodes them like a viewer
+ * and compares the picture. Covers the worst case delta (checkerboard after a blank frame),
+ * which has to fit the message buffer. POSIX only.
+ */
+#include "stream.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+static uint8_t picture[SCREEN_WIDTH * SCREEN_HEIGHT];//what the viewer has
+
+/* Decode one message from the pipe. Returns its type, 0 on error */
+static int receive(int fd) {
+    static uint8_t msg[1 << 16];
+    ssize_t n = read(fd, msg, sizeof(msg));
+    if (n < 5)
+        return 0;
+    if (msg[0] == STREAM_KEYFRAME) {
+        if (n != 5 + (ssize_t)sizeof(picture))
+            return 0;
+        memcpy(picture, msg + 5, sizeof(picture));
+        return STREAM_KEYFRAME;
+    }
+    if (msg[0] != STREAM_DELTA || n < 9)
+        return 0;
+    uint32_t rows = (uint32_t)(msg[5] | msg[6] << 8 | msg[7] << 16 | (uint32_t)msg[8] << 24);
+    ssize_t p = 9;
+    for (int y = 0; y < SCREEN_HEIGHT; y++) {
+        if (!(rows & (1u << y)))
+            continue;
+        uint8_t *row = picture + y * SCREEN_WIDTH;
+        int x = 0;
+        while (x < SCREEN_WIDTH) {
+            if (p + 2 > n)
+                return 0;
+            int skip = msg[p++], count = msg[p++];
+            x += skip;
+            if (x + count > SCREEN_WIDTH || p + count > n)
+                return 0;
+            for (int k = 0; k < count; k++)
+                row[x++] ^= msg[p++];
+        }
+    }
+    return p == n ? STREAM_DELTA : 0;
+}
+
+static int check(Stream *s, int fd, VMemory *vm, uint64_t frame, int type, const char *what) {
+    vm->dirty_rows = ALL_ROWS;
+    stream_frame(s, vm, frame);
+    if (receive(fd) != type || memcmp(picture, vm->buffer, sizeof(picture)) != 0) {
+        printf("FAIL  %s\n", what);
+        return 1;
+    }
+    printf("PASS  %s\n", what);
+    return 0;
+}
+
+int main(void) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        perror("pipe");
+        return 1;
+    }
+    Stream s;
+    memset(&s, 0, sizeof(s));
+    s.fd = fds[1];
+    s.in_fd = -1;
+
+    VMemory vm;
+    vmemory_init(&vm);
+    int failed = check(&s, fds[0], &vm, 0, STREAM_KEYFRAME, "blank keyframe");
+
+    for (int y = 0; y < SCREEN_HEIGHT; y++)
+        for (int x = 0; x < SCREEN_WIDTH; x++)
+            vm.buffer[idx(x, y)] = (uint8_t)((x + y) & 1);
+    failed += check(&s, fds[0], &vm, 1, STREAM_DELTA, "checkerboard delta");
+
+    for (size_t i = 0; i < sizeof(vm.buffer); i++)
+        vm.buffer[i] = (uint8_t)(i % 3 == 0 ? 0x0F : vm.buffer[i]);//XO-CHIP values, runs of other lengths
+    failed += check(&s, fds[0], &vm, 2, STREAM_DELTA, "mixed plane delta");
+
+    stream_close(&s);
+    close(fds[1]);
+    close(fds[0]);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,205 @@
+#include "term.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#define ESC "\x1b"
+#define UPPER_HALF "\xe2\x96\x80" //U+2580
+#define LOWER_HALF "\xe2\x96\x84" //U+2584
+#define FULL_BLOCK "\xe2\x96\x88" //U+2588
+
+/* Same layout as the SDL keyboard (input.c), lower and upper case */
+static const char KEYS[16] = {
+    'x', '1', '2', '3', 'q', 'w', 'e', 'a', 's', 'd', 'z', 'c', '4', 'r', 'f', 'v'
+};
+
+static void put(Terminal *t, const char *s) {
+    size_t n = strlen(s);
+    memcpy(t->out + t->out_len, s, n);
+    t->out_len += n;
+}
+
+/* One write per frame, repeated only if the kernel took part of it */
+static int flush(Terminal *t) {
+    const char *p = t->out;
+    size_t n = t->out_len;
+    t->out_len = 0;
+    while (n > 0) {
+#ifdef _WIN32
+        long w = _write(t->out_fd, p, (unsigned)n);
+#else
+        ssize_t w = write(t->out_fd, p, n);
+        if (w < 0 && errno == EINTR)
+            continue;
+#endif
+        if (w <= 0)
+            return 1;
+        p += w;
+        n -= (size_t)w;
+    }
+    return 0;
+}
+
+static void repaint(Terminal *t) {
+    for (int r = 0; r < TERM_ROWS; r++)
+        for (int x = 0; x < SCREEN_WIDTH; x++)
+            t->cells[r][x] = TERM_CELL_UNKNOWN;
+    t->fg = t->bg = -1;
+    t->row = t->col = -1;
+    put(t, ESC "[0m" ESC "[2J");
+}
+
+int term_init(Terminal *t, ColorTheme theme) {
+    memset(t, 0, sizeof(*t));
+    t->in_fd = 0;
+    t->out_fd = 1;
+#ifdef _WIN32
+    (void)theme;
+    fprintf(stderr, "[term] the terminal frontend needs a POSIX terminal\n");
+    return 1;
+#else
+    display_palette_from_theme(theme, t->palette);
+    if (isatty(t->in_fd) && tcgetattr(t->in_fd, &t->saved) == 0) {
+        struct termios raw = t->saved;
+        raw.c_iflag &= ~(tcflag_t)(BRKINT | ICRNL | INPCK | ISTRIP | IXON);
+        raw.c_lflag &= ~(tcflag_t)(ECHO | ICANON | IEXTEN | ISIG);//Ctrl-C arrives as a byte
+        raw.c_cc[VMIN] = 0;//read returns what is there, nothing blocks
+        raw.c_cc[VTIME] = 0;
+        if (tcsetattr(t->in_fd, TCSAFLUSH, &raw) == 0)
+            t->raw = true;
+    }
+    if (!t->raw)
+        fprintf(stderr, "[term] stdin is not a terminal, no keypad input\n");
+    put(t, ESC "[?1049h" ESC "[?25l");//alternate screen, hide the cursor
+    repaint(t);
+    return flush(t);
+#endif
+}
+
+void term_poll(Terminal *t, InputEvent *ev) {
+    memset(ev, 0, sizeof(*ev));
+    for (int k = 0; k < 16; k++)
+        if (t->key_frames[k]) {
+            t->key_frames[k]--;
+            ev->keypad[k] = 1;
+        }
+#ifndef _WIN32
+    if (!t->raw)
+        return;
+    unsigned char buf[64];
+    ssize_t n;
+    while ((n = read(t->in_fd, buf, sizeof(buf))) > 0) {
+        for (ssize_t i = 0; i < n; i++) {
+            unsigned char c = buf[i];
+            if (c == 0x1b) {
+                if (i + 1 == n) {//a lone Esc, not the start of an arrow key or similar
+                    ev->quit = 1;
+                    continue;
+                }
+                if (buf[i + 1] == '[' || buf[i + 1] == 'O') {//skip the whole sequence
+                    for (i += 2; i < n && (buf[i] < 0x40 || buf[i] > 0x7E); i++)
+                        ;
+                }
+                continue;
+            }
+            if (c == 0x03) ev->quit = 1;//Ctrl-C
+            if (c == 0x0c) repaint(t);//Ctrl-L
+            if (c == ' ') ev->restart = 1;
+            if (c >= 'A' && c <= 'Z')
+                c = (unsigned char)(c - 'A' + 'a');
+            for (int k = 0; k < 16; k++)
+                if (c == (unsigned char)KEYS[k]) {
+                    t->key_frames[k] = TERM_KEY_HOLD_FRAMES;
+                    ev->keypad[k] = 1;
+                }
+        }
+    }
+#endif
+}
+
+/* SGR for the colors that differ from the current ones */
+static void set_colors(Terminal *t, int fg, int bg) {
+    char s[48];
+    int len = 0;
+    if (fg != t->fg) {
+        uint32_t c = t->palette[fg];
+        len += snprintf(s + len, sizeof(s) - (size_t)len, ESC "[38;2;%u;%u;%u",
+                        (unsigned)(c >> 16) & 0xFF, (unsigned)(c >> 8) & 0xFF, (unsigned)c & 0xFF);
+        t->fg = fg;
+    }
+    if (bg != t->bg) {
+        uint32_t c = t->palette[bg];
+        len += snprintf(s + len, sizeof(s) - (size_t)len, len ? ";48;2;%u;%u;%u" : ESC "[48;2;%u;%u;%u",
+                        (unsigned)(c >> 16) & 0xFF, (unsigned)(c >> 8) & 0xFF, (unsigned)c & 0xFF);
+        t->bg = bg;
+    }
+    if (len) {
+        s[len++] = 'm';
+        s[len] = '\0';
+        put(t, s);
+    }
+}
+
+/* The character for a cell and the colors it needs, picking the one that changes the fewest colors */
+static void put_cell(Terminal *t, int top, int bottom) {
+    if (top == bottom) {
+        if (t->bg == top) {
+            put(t, " ");
+        } else if (t->fg == top) {
+            put(t, FULL_BLOCK);
+        } else {
+            set_colors(t, t->fg < 0 ? top : t->fg, top);
+            put(t, " ");
+        }
+        return;
+    }
+    int upper = (t->fg != top) + (t->bg != bottom);
+    int lower = (t->fg != bottom) + (t->bg != top);
+    if (upper <= lower) {
+        set_colors(t, top, bottom);
+        put(t, UPPER_HALF);
+    } else {
+        set_colors(t, bottom, top);
+        put(t, LOWER_HALF);
+    }
+}
+
+int term_draw(Terminal *t, const uint8_t *pixels) {
+    for (int r = 0; r < TERM_ROWS; r++) {
+        const uint8_t *top = pixels + (size_t)(2 * r) * SCREEN_WIDTH;
+        const uint8_t *bottom = top + SCREEN_WIDTH;
+        for (int x = 0; x < SCREEN_WIDTH; x++) {
+            uint16_t cell = (uint16_t)((top[x] & (PALETTE_SIZE - 1)) | (bottom[x] & (PALETTE_SIZE - 1)) << 4);
+            if (cell == t->cells[r][x])
+                continue;
+            if (r != t->row || x != t->col) {
+                char move[16];
+                snprintf(move, sizeof(move), ESC "[%d;%dH", r + 1, x + 1);
+                put(t, move);
+            }
+            put_cell(t, cell & 0x0F, cell >> 4);
+            t->cells[r][x] = cell;
+            t->row = r;
+            t->col = x + 1;
+        }
+    }
+    return flush(t);
+}
+
+void term_shutdown(Terminal *t) {
+#ifndef _WIN32
+    if (t->out_fd != 1)
+        return;//never initialized
+    put(t, ESC "[0m" ESC "[?25h" ESC "[?1049l");
+    flush(t);
+    if (t->raw)
+        tcsetattr(t->in_fd, TCSAFLUSH, &t->saved);
+    t->raw = false;
+#endif
+}
@@ -0,0 +1,53 @@
+#ifndef TERM_H
+#define TERM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "display.h" // For ColorTheme, PALETTE_SIZE
+#include "input.h" // For InputEvent
+
+#ifndef _WIN32
+#include <termios.h>
+#endif
+
+#define TERM_ROWS (SCREEN_HEIGHT / 2) //one character cell shows two pixels, top and bottom half
+#define TERM_CELL_MAX 48 //worst case bytes per cell: cursor move, both colors, a 3 byte half block
+#define TERM_OUT_MAX (TERM_ROWS * SCREEN_WIDTH * TERM_CELL_MAX + 64)
+#define TERM_CELL_UNKNOWN 0xFFFF //not a packed cell, whose values stop at 0xFF
+#define TERM_KEY_HOLD_FRAMES 8 //a terminal only sends presses: a key is down this long after its last byte
+
+/*
+ * Terminal frontend (--term): the framebuffer as Unicode half blocks with 24-bit colors, for machines
+ * reached over SSH. The terminal keeps what it shows, so term_draw only sends the cells that changed
+ * since the last frame, with a cursor move only where the changed cells aren't adjacent and a color
+ * change only where the cell needs other colors than the last one written. A frame is one write().
+ * Input comes from stdin in raw mode and never blocks.
+ */
+typedef struct {
+    int in_fd, out_fd;
+    bool raw;//stdin switched to raw mode, term_shutdown restores it
+#ifndef _WIN32
+    struct termios saved;
+#endif
+    uint32_t palette[PALETTE_SIZE];//ARGB8888
+    uint16_t cells[TERM_ROWS][SCREEN_WIDTH];//what the terminal shows: top pixel | bottom pixel << 4, or TERM_CELL_UNKNOWN
+    int fg, bg;//colors last set (palette index), -1 = unknown
+    int row, col;//cursor position, -1 = unknown
+    uint8_t key_frames[16];//per key: frames it stays down
+    size_t out_len;
+    char out[TERM_OUT_MAX];//one frame of output
+} Terminal;
+
+/* Switch stdin to raw mode (if it is a terminal), use the alternate screen and hide the cursor.
+   Returns 0 on success */
+int term_init(Terminal *t, ColorTheme theme);
+/* Call once per frame. Keypad on 1234/QWER/ASDF/ZXCV, Space restarts, Esc or Ctrl-C quits,
+   Ctrl-L repaints everything */
+void term_poll(Terminal *t, InputEvent *ev);
+/* 'pixels' is SCREEN_WIDTH * SCREEN_HEIGHT plane bitmasks. Returns 0 on success (also if nothing changed) */
+int term_draw(Terminal *t, const uint8_t *pixels);
+/* Restores the terminal. Safe to call even if init failed */
+void term_shutdown(Terminal *t);
+
+#endif /* TERM_H */
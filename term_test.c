@@ -0,0 +1,159 @@
+/*
+ * term.c self check (make term-test): draws frames into a file, replays the escape sequences like
+ * a terminal would and compares the cells. Covers color 15 on both halves of a cell (the packed
+ * value 0xFF) right after init and after a Ctrl-L repaint, and that an unchanged frame sends
+ * nothing. POSIX only.
+ */
+#include "term.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define UNKNOWN -1 //cleared, not drawn since
+#define BROKEN -2 //drawn with a color that was never set
+
+static int screen[TERM_ROWS][SCREEN_WIDTH];//what the terminal shows: top | bottom << 4
+static uint8_t pixels[SCREEN_WIDTH * SCREEN_HEIGHT];
+
+static int color_index(const Terminal *t, unsigned r, unsigned g, unsigned b) {
+    uint32_t c = 0xFF000000u | r << 16 | g << 8 | b;
+    for (unsigned i = 0; i < PALETTE_SIZE; i++)
+        if (t->palette[i] == c)
+            return (int)i;
+    return BROKEN;
+}
+
+/* Replay what term.c wrote since the last call. Returns the number of bytes */
+static long replay(const Terminal *t) {
+    static char out[TERM_OUT_MAX];
+    static int row, col, fg = BROKEN, bg = BROKEN;
+    long n = (long)lseek(t->out_fd, 0, SEEK_CUR);
+    if (n <= 0 || lseek(t->out_fd, 0, SEEK_SET) != 0 || read(t->out_fd, out, (size_t)n) != n)
+        return n;
+    lseek(t->out_fd, 0, SEEK_SET);
+    if (ftruncate(t->out_fd, 0) != 0)
+        return -1;
+    for (long i = 0; i < n;) {
+        if (out[i] == '\x1b' && i + 1 < n && out[i + 1] == '[') {
+            int p[16], count = 0, v = 0;
+            for (i += 2; i < n && (out[i] == ';' || out[i] == '?' || (out[i] >= '0' && out[i] <= '9')); i++) {
+                if (out[i] == ';') {
+                    if (count < 16) p[count++] = v;
+                    v = 0;
+                } else if (out[i] != '?') {
+                    v = v * 10 + out[i] - '0';
+                }
+            }
+            if (count < 16) p[count++] = v;
+            char final = i < n ? out[i++] : 0;
+            if (final == 'H') {
+                row = p[0] - 1;
+                col = count > 1 ? p[1] - 1 : 0;
+            } else if (final == 'J') {
+                for (int r = 0; r < TERM_ROWS; r++)
+                    for (int x = 0; x < SCREEN_WIDTH; x++)
+                        screen[r][x] = UNKNOWN;
+            } else if (final == 'm') {
+                for (int k = 0; k < count; k++) {
+                    if (p[k] == 0) {
+                        fg = bg = BROKEN;
+                    } else if ((p[k] == 38 || p[k] == 48) && k + 4 < count && p[k + 1] == 2) {
+                        int c = color_index(t, (unsigned)p[k + 2], (unsigned)p[k + 3], (unsigned)p[k + 4]);
+                        *(p[k] == 38 ? &fg : &bg) = c;
+                        k += 4;
+                    }
+                }
+            }
+            continue;
+        }
+        int top, bottom;
+        if (out[i] == ' ') {
+            top = bottom = bg;
+            i++;
+        } else if (i + 2 < n && !memcmp(out + i, "\xe2\x96", 2)) {
+            unsigned char c = (unsigned char)out[i + 2];
+            top = c == 0x84 ? bg : fg;//lower half: the top is the background
+            bottom = c == 0x80 ? bg : fg;//upper half: the bottom is the background
+            i += 3;
+        } else {
+            return -1;
+        }
+        if (row < 0 || row >= TERM_ROWS || col < 0 || col >= SCREEN_WIDTH)
+            return -1;
+        screen[row][col++] = top < 0 || bottom < 0 ? BROKEN : top | bottom << 4;
+    }
+    return n;
+}
+
+static int check(Terminal *t, const char *what, bool expect_output) {
+    int ok = term_draw(t, pixels) == 0;
+    long n = replay(t);
+    ok = ok && n >= 0 && (n > 0) == expect_output;
+    for (int r = 0; ok && r < TERM_ROWS; r++)
+        for (int x = 0; ok && x < SCREEN_WIDTH; x++)
+            ok = screen[r][x] == (pixels[2 * r * SCREEN_WIDTH + x] | pixels[(2 * r + 1) * SCREEN_WIDTH + x] << 4);
+    printf("%s  %s (%ld bytes)\n", ok ? "PASS" : "FAIL", what, n);
+    return ok ? 0 : 1;
+}
+
+static void fill(uint8_t (*pattern)(int x, int y)) {
+    for (int y = 0; y < SCREEN_HEIGHT; y++)
+        for (int x = 0; x < SCREEN_WIDTH; x++)
+            pixels[y * SCREEN_WIDTH + x] = pattern(x, y);
+}
+
+static uint8_t white(int x, int y) { (void)x; (void)y; return PALETTE_SIZE - 1; }
+static uint8_t checkerboard(int x, int y) { return (x + y) & 1 ? PALETTE_SIZE - 1 : 0; }
+static uint8_t mixed(int x, int y) { return (uint8_t)((x * 7 + y * 3 + x * y) & (PALETTE_SIZE - 1)); }
+
+int main(void) {
+    static Terminal t;
+    ColorTheme theme;
+    memset(&theme, 0, sizeof(theme));
+    FILE *out = tmpfile();
+    int saved = dup(1);
+    if (!out || saved < 0 || dup2(fileno(out), 1) < 0) {
+        perror("tmpfile");
+        return 1;
+    }
+    int rc = term_init(&t, theme);//writes to stdout, which is the file for now
+    dup2(saved, 1);
+    close(saved);
+    if (rc != 0) {
+        printf("FAIL  term_init\n");
+        return 1;
+    }
+    t.out_fd = fileno(out);
+    for (unsigned i = 0; i < PALETTE_SIZE; i++)
+        t.palette[i] = 0xFF000000u | i * 0x111111u;//distinct, so colors map back to indexes
+    replay(&t);
+
+    fill(white);
+    int failed = check(&t, "color 15 after init", true);
+    failed += check(&t, "unchanged frame", false);
+    fill(checkerboard);
+    failed += check(&t, "checkerboard", true);
+    fill(mixed);
+    failed += check(&t, "mixed colors", true);
+
+    int fds[2];
+    if (pipe(fds) != 0) {
+        perror("pipe");
+        return 1;
+    }
+    if (write(fds[1], "\x0c", 1) != 1)//Ctrl-L
+        return 1;
+    close(fds[1]);
+    t.in_fd = fds[0];
+    t.raw = true;//term_poll only reads a raw terminal
+    InputEvent ev;
+    term_poll(&t, &ev);
+    t.raw = false;
+    close(fds[0]);
+    fill(white);
+    failed += check(&t, "color 15 after Ctrl-L", true);
+
+    fclose(out);
+    return failed ? 1 : 0;
+}
@@ -4,12 +4,49 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+/*
+ * Lazy 60Hz timers: nothing is decremented per frame. A write stores the value and the frame it
+ * happened in, a read computes what is left. A timer written with V during frame w reads
+ * V - (f - w) during frame f (never below 0), exactly as if it had been decremented at the start
+ * of every frame, so frames can be skipped or batched without touching the timers.
+ */
 typedef struct {
-    uint8_t delay_timer;
-    uint8_t sound_timer;
+    uint8_t delay_value;//written by Fx15
+    uint8_t sound_value;//written by Fx18
+    uint64_t delay_stamp;//frame of the write
+    uint64_t sound_stamp;
+    uint64_t frame;//current 60Hz frame (cpu_run_frame)
 } Timer;
 
 void timer_init(Timer *t);
-bool timer_update(Timer *t);
+
+static inline uint8_t timer_left(uint8_t value, uint64_t stamp, uint64_t frame) {
+    uint64_t elapsed = frame - stamp;
+    return (elapsed >= value) ? 0 : (uint8_t)(value - elapsed);
+}
+
+static inline uint8_t timer_delay(const Timer *t) {
+    return timer_left(t->delay_value, t->delay_stamp, t->frame);
+}
+
+static inline uint8_t timer_sound(const Timer *t) {
+    return timer_left(t->sound_value, t->sound_stamp, t->frame);
+}
+
+static inline void timer_set_delay(Timer *t, uint8_t value) {
+    t->delay_value = value;
+    t->delay_stamp = t->frame;
+}
+
+static inline void timer_set_sound(Timer *t, uint8_t value) {
+    t->sound_value = value;
+    t->sound_stamp = t->frame;
+}
+
+/* Beeper state in frame 'frame': the sound timer was not zero when that frame started.
+   A write of V during frame w sounds in frames w+1 .. w+V. */
+static inline bool timer_sound_on(const Timer *t, uint64_t frame) {
+    return frame > t->sound_stamp && frame - t->sound_stamp <= t->sound_value;
+}
 
 #endif
@@ -0,0 +1,30 @@
+#include "tribuf.h"
+#include <string.h>
+
+#define TRIBUF_FRESH 4 //above the slot index bits
+
+void tribuf_init(TripleBuffer *tb) {
+    memset(tb->slots, 0, sizeof(tb->slots));
+    tb->back = 0;
+    SDL_AtomicSet(&tb->middle, 1);
+    tb->front = 2;
+}
+
+FrameSlot *tribuf_back(TripleBuffer *tb) {
+    return &tb->slots[tb->back];
+}
+
+void tribuf_publish(TripleBuffer *tb) {
+    SDL_MemoryBarrierRelease();//slot contents before the index
+    int old = SDL_AtomicSet(&tb->middle, tb->back | TRIBUF_FRESH);
+    tb->back = old & ~TRIBUF_FRESH;//an untaken older frame is simply overwritten next
+}
+
+FrameSlot *tribuf_take(TripleBuffer *tb) {
+    if (!(SDL_AtomicGet(&tb->middle) & TRIBUF_FRESH))
+        return NULL;
+    int old = SDL_AtomicSet(&tb->middle, tb->front);
+    SDL_MemoryBarrierAcquire();//index before the slot contents
+    tb->front = old & ~TRIBUF_FRESH;
+    return &tb->slots[tb->front];
+}
@@ -0,0 +1,37 @@
+#ifndef TRIBUF_H
+#define TRIBUF_H
+
+#include <stdint.h>
+#include "SDL.h"
+#include "vmemory.h"
+#include "metrics.h"
+
+/* One finished frame, handed from the emulation thread to the render thread */
+typedef struct {
+    uint8_t pixels[SCREEN_WIDTH * SCREEN_HEIGHT];
+    FrameSample last;//timing of the frame before, for the overlay
+    uint64_t frame;
+} FrameSlot;
+
+/*
+ * Lock-free triple buffer between exactly one writer and one reader.
+ * The writer fills its back slot and publishes it, the reader takes the newest published slot.
+ * Both are a single atomic exchange of the middle slot index, so neither side ever waits for
+ * the other. Frames the reader was too slow for are dropped, it always gets the latest one.
+ */
+typedef struct {
+    FrameSlot slots[3];
+    SDL_atomic_t middle;//slot index, TRIBUF_FRESH set while the reader has not taken it
+    int back;//owned by the writer
+    int front;//owned by the reader
+} TripleBuffer;
+
+void tribuf_init(TripleBuffer *tb);
+/* Writer: the slot to fill next */
+FrameSlot *tribuf_back(TripleBuffer *tb);
+/* Writer: make the back slot the newest frame */
+void tribuf_publish(TripleBuffer *tb);
+/* Reader: the newest frame, or NULL if nothing was published since the last call */
+FrameSlot *tribuf_take(TripleBuffer *tb);
+
+#endif /* TRIBUF_H */
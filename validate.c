@@ -0,0 +1,223 @@
+#include "validate.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "memory.h"
+#include "timer.h"
+#include "vmemory.h"
+#include "cpu.h"
+#include "replay.h"
+#include "snapshot.h"
+#include "debugger.h"
+
+typedef struct {
+    uint16_t pc[VALIDATE_HISTORY];
+    uint16_t op[VALIDATE_HISTORY];
+    uint64_t count;//instructions recorded, the ring holds the last VALIDATE_HISTORY
+} History;
+
+static void history_add(void *user, uint16_t pc, uint16_t op_code) {
+    History *h = user;
+    h->pc[h->count % VALIDATE_HISTORY] = pc;
+    h->op[h->count % VALIDATE_HISTORY] = op_code;
+    h->count++;
+}
+
+typedef struct {
+    Memory mem;
+    Cpu cpu;
+    Snapshot frame_start;
+    int64_t credit;//CPU budget carried between frames, like emulate_chip8
+} Machine;
+
+static int machine_init(Machine *m, const uint8_t *program, size_t len, const Config *config) {
+    Timer timer;
+    VMemory vmemory;
+    if (memory_new(&m->mem, program, len) != 0) {
+        fprintf(stderr, "[validate] ROM does not fit in memory\n");
+        return 1;
+    }
+    if (snapshot_init(&m->frame_start) != 0) {
+        memory_free(&m->mem);
+        return 1;
+    }
+    timer_init(&timer);
+    vmemory_init(&vmemory);
+    cpu_new(&m->cpu, &m->mem, &timer, &vmemory);
+    cpu_set_profile(&m->cpu, config->profile);
+    cpu_set_timing(&m->cpu, config->timing);
+    m->credit = 0;
+    return 0;
+}
+
+static void machine_free(Machine *m) {
+    snapshot_free(&m->frame_start);
+    memory_free(&m->cpu.memory);
+}
+
+/* First part of the architectural state that differs, NULL if none. Bookkeeping that is allowed to
+   differ (idle flag, cost of the last instruction, latency probe counters) is not compared. */
+static const char *state_diff(const Cpu *a, const Cpu *b) {
+    if (a->pc != b->pc) return "PC";
+    if (a->i != b->i) return "I";
+    if (memcmp(a->v, b->v, sizeof(a->v)) != 0) return "V registers";
+    if (a->sp != b->sp || memcmp(a->stack, b->stack, sizeof(a->stack)) != 0) return "stack";
+    if (timer_delay(&a->timer) != timer_delay(&b->timer) || timer_sound(&a->timer) != timer_sound(&b->timer) ||
+        a->timer.sound_stamp != b->timer.sound_stamp)
+        return "timers";
+    if (a->instructions != b->instructions) return "instruction count";
+    if (a->key_wait != b->key_wait || a->key_wait_reg != b->key_wait_reg ||
+        a->key_wait_key != b->key_wait_key || a->key_wait_held != b->key_wait_held)
+        return "key wait";
+    if (a->vblank_wait != b->vblank_wait) return "display wait";
+    if (a->rng != b->rng) return "random state";
+    if (a->audio_pitch != b->audio_pitch || memcmp(a->audio_pattern, b->audio_pattern, sizeof(a->audio_pattern)) != 0)
+        return "audio";
+    if (a->vmemory.plane_mask != b->vmemory.plane_mask ||
+        memcmp(a->vmemory.buffer, b->vmemory.buffer, sizeof(a->vmemory.buffer)) != 0)
+        return "framebuffer";
+    if (memcmp(a->memory.mem, b->memory.mem, MEMORY_SIZE) != 0) return "RAM";
+    return NULL;
+}
+
+static void dump_state(const char *name, const Cpu *c, const Cpu *other) {
+    fprintf(stderr, "[validate] %s: PC %04X  I %04X  SP %X  DT %02X  ST %02X  instructions %" PRIu64 "%s%s\n",
+            name, c->pc, c->i, c->sp, timer_delay(&c->timer), timer_sound(&c->timer), c->instructions,
+            c->key_wait ? "  (key wait)" : "", c->vblank_wait ? "  (display wait)" : "");
+    fprintf(stderr, "[validate] %s: V", name);
+    for (int r = 0; r < 16; r++)
+        fprintf(stderr, " %02X", c->v[r]);
+    fprintf(stderr, "\n[validate] %s: stack", name);
+    for (int s = 0; s < c->sp && s < STACK_SIZE; s++)
+        fprintf(stderr, " %04X", c->stack[s]);
+    fprintf(stderr, "\n");
+
+    /* The first few RAM bytes that differ, with their address */
+    int shown = 0;
+    for (uint32_t a = 0; a < MEMORY_SIZE && shown < 8; a++) {
+        if (c->memory.mem[a] == other->memory.mem[a])
+            continue;
+        if (shown++ == 0)
+            fprintf(stderr, "[validate] %s: RAM differs at", name);
+        fprintf(stderr, " %04X:%02X", a, c->memory.mem[a]);
+    }
+    if (shown)
+        fprintf(stderr, "\n");
+    uint32_t pixels = 0;
+    for (size_t p = 0; p < sizeof(c->vmemory.buffer); p++)
+        pixels += c->vmemory.buffer[p] != other->vmemory.buffer[p];
+    if (pixels)
+        fprintf(stderr, "[validate] %s: %u pixels differ\n", name, (unsigned)pixels);
+}
+
+static void dump_history(const History *h) {
+    uint64_t n = h->count < VALIDATE_HISTORY ? h->count : VALIDATE_HISTORY;
+    fprintf(stderr, "[validate] last %" PRIu64 " reference instructions:\n", n);
+    for (uint64_t k = h->count - n; k < h->count; k++) {
+        char text[24];
+        uint16_t op = h->op[k % VALIDATE_HISTORY];
+        debugger_disassemble(op, text, sizeof(text));
+        fprintf(stderr, "[validate]   %04X  %04X  %s\n", h->pc[k % VALIDATE_HISTORY], op, text);
+    }
+}
+
+/* The frame diverged: replay it with budgets 1, 2, ... until the states first differ */
+static int64_t narrow_down(Machine *fast, Machine *ref, History *history, const History *at_frame_start,
+                           const uint8_t keypad[16], uint64_t frame, int64_t budget) {
+    for (int64_t k = 1; k < budget; k++) {
+        int64_t spent_fast = 0, spent_ref = 0;
+        snapshot_restore(&fast->frame_start, &fast->cpu);
+        snapshot_restore(&ref->frame_start, &ref->cpu);
+        *history = *at_frame_start;
+        int rc_fast = cpu_run_frame(&fast->cpu, keypad, frame, k, &spent_fast);
+        int rc_ref = cpu_run_frame_reference(&ref->cpu, keypad, frame, k, &spent_ref, history_add, history);
+        if (rc_fast != rc_ref || spent_fast != spent_ref || state_diff(&fast->cpu, &ref->cpu))
+            return k;
+    }
+    return budget;//the states after the whole frame, as found
+}
+
+int validate_run(const Config *config) {
+    size_t got = 0;
+    uint8_t *program = memory_read_rom(config->program_filename, &got);
+    if (!program) {
+        fprintf(stderr, "Failed to read ROM: %s\n", config->program_filename);
+        return 1;
+    }
+
+    static Machine fast, ref;
+    static History history, at_frame_start;
+    Replay replay;
+    int rc = 0;
+    if (machine_init(&fast, program, got, config) != 0) {
+        free(program);
+        return 1;
+    }
+    if (machine_init(&ref, program, got, config) != 0) {
+        machine_free(&fast);
+        free(program);
+        return 1;
+    }
+    free(program);
+    if (replay_open(&replay, config->input_script, NULL) != 0) {
+        machine_free(&fast);
+        machine_free(&ref);
+        return 1;
+    }
+
+    uint64_t cpu_clock = config->cpu_clock ? config->cpu_clock : DEFAULT_CPU_CLOCK;
+    uint64_t frames = config->max_frames ? config->max_frames : VALIDATE_DEFAULT_FRAMES;
+    uint64_t frame;
+    for (frame = 0; frame < frames; frame++) {
+        uint8_t keypad[16];
+        keypad_from_bits(replay_keys(&replay, frame), keypad);
+        int64_t budget = cpu_frame_budget(config->timing, cpu_clock, frame);
+        fast.credit += budget;
+        ref.credit += budget;
+
+        snapshot_save(&fast.frame_start, &fast.cpu);
+        snapshot_save(&ref.frame_start, &ref.cpu);
+        at_frame_start = history;
+
+        int64_t spent_fast = 0, spent_ref = 0;
+        int rc_fast = cpu_run_frame(&fast.cpu, keypad, frame, fast.credit, &spent_fast);
+        int rc_ref = cpu_run_frame_reference(&ref.cpu, keypad, frame, ref.credit, &spent_ref, history_add, &history);
+        const char *diff = state_diff(&fast.cpu, &ref.cpu);
+        if (!diff && spent_fast != spent_ref) diff = "budget spent";
+        if (!diff && rc_fast != rc_ref) diff = "result";
+
+        if (diff) {
+            int64_t k = narrow_down(&fast, &ref, &history, &at_frame_start, keypad, frame, fast.credit);
+            diff = state_diff(&fast.cpu, &ref.cpu);
+            fprintf(stderr, "[validate] engines diverge in frame %" PRIu64 " (%s), first with a budget of %" PRId64
+                    " of %" PRId64 "\n", frame, diff ? diff : "budget spent or result", k, fast.credit);
+            dump_state("fast", &fast.cpu, &ref.cpu);
+            dump_state("reference", &ref.cpu, &fast.cpu);
+            dump_history(&history);
+            rc = 1;
+            break;
+        }
+        if (rc_ref != 0) {
+            printf("[validate] both engines stopped on a failing instruction at PC %04X in frame %" PRIu64 "\n",
+                   ref.cpu.pc, frame);
+            break;
+        }
+
+        fast.credit -= spent_fast;
+        ref.credit -= spent_ref;
+        if (fast.credit > 0) fast.credit = 0;
+        if (ref.credit > 0) ref.credit = 0;
+        fast.cpu.vmemory.draw_flag = false;
+        ref.cpu.vmemory.draw_flag = false;
+    }
+    if (rc == 0)
+        printf("[validate] %" PRIu64 " frames, %" PRIu64 " instructions: the engines agree\n",
+               frame, ref.cpu.instructions);
+
+    replay_close(&replay);
+    machine_free(&fast);
+    machine_free(&ref);
+    return rc;
+}
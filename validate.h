@@ -0,0 +1,20 @@
+#ifndef VALIDATE_H
+#define VALIDATE_H
+
+#include "chip8.h"
+
+#define VALIDATE_DEFAULT_FRAMES 3600 //one minute of play when --frames is not given
+#define VALIDATE_HISTORY 32 //reference instructions shown before a divergence
+
+/*
+ * --validate: differential test of the fast engine (cpu_run_frame: superinstructions, idle loop
+ * skipping) against the reference (cpu_run_frame_reference: the plain switch interpreter, one
+ * instruction at a time). Two machines run the ROM in lock step with the same budgets and keypad
+ * (--input-script or no keys). After every frame registers, I, PC, stack, timers, RAM and the
+ * framebuffer must match. On the first difference the frame is replayed from snapshots with a growing
+ * budget to find the instruction it starts at, then both states and the reference's last instructions
+ * are printed. Headless. Returns 0 when the engines agreed on every frame.
+ */
+int validate_run(const Config *config);
+
+#endif /* VALIDATE_H */
@@ -4,46 +4,69 @@
 void vmemory_init(VMemory *vm) {
     memset(vm->buffer, 0, sizeof(vm->buffer));
     vm->draw_flag = true;
+    vm->plane_mask = 0x1;//plane 0 only, plain CHIP-8
+    vm->dirty_rows = ALL_ROWS;
 }
 
+/* Clear only the selected planes, other planes keep their pixels (XO-CHIP 00E0) */
 void vmemory_clear(VMemory *vm) {
-    memset(vm->buffer, 0, sizeof(vm->buffer));
+    if (vm->plane_mask == 0x1) {//fast path, only plane 0 is ever used by CHIP-8 programs
+        memset(vm->buffer, 0, sizeof(vm->buffer));
+    } else {
+        uint8_t keep = (uint8_t)~vm->plane_mask;
+        for (size_t i = 0; i < sizeof(vm->buffer); i++)
+            vm->buffer[i] &= keep;
+    }
     vm->draw_flag = true;
+    vm->dirty_rows = ALL_ROWS;
 }
-/// @brief 
-/// @param vm 
-/// @param x_pos : x cordinate (Vx)
-/// @param y_pos : y cordinate (Vy)
-/// @param sprite : pointer to sprite buffer
-/// @param sprite_height : number of rows
-/// @return : collision flag VF
-uint8_t vmemory_draw_sprite_no_wrap(VMemory *vm, uint8_t x_pos, uint8_t y_pos, const uint8_t *sprite, int sprite_height)
-{
-    /*
-        sprite_height: sprint hight to draw
-        Each sprite is 8 pixel width, each sprite row = 1 byte = 8 pixcels
-        Use xor drawing and detect collisions(if any pixcel is turned off during drawing, set VF=1)
-        return VF (collision flag)
-    */
-    vm->draw_flag = true;
 
-    size_t x, curr_y;
-    normalize_coordinates(x_pos, y_pos, &x, &curr_y);//safe screen indices
+/* 64 bit hash of the screen buffer for regression checks (not cryptographic).
+   8 pixels per multiply, ~256 rounds for the whole screen. Words are read in host byte order,
+   checked-in hashes assume a little endian host */
+uint64_t vmemory_hash(const VMemory *vm) {
+    uint64_t h = 0x9E3779B97F4A7C15ULL;
+    for (size_t i = 0; i < sizeof(vm->buffer); i += 8) {
+        uint64_t w;
+        memcpy(&w, vm->buffer + i, sizeof(w));
+        h = (h ^ w) * 0xFF51AFD7ED558CCDULL;
+        h ^= h >> 29;
+    }
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    return h;
+}
 
+/* Fn01 - select drawing planes, n is a bitmask of up to four planes */
+void vmemory_select_planes(VMemory *vm, uint8_t mask) {
+    vm->plane_mask = (uint8_t)(mask & ((1u << PLANE_COUNT) - 1));
+}
+/* Draw one sprite into a single plane (plane_bit).
+   wrap is a constant at every call site, so the compiler emits a clipping and a wrapping copy */
+static inline uint8_t draw_plane(VMemory *vm, size_t x, size_t y, const uint8_t *sprite, int sprite_height,
+                                 uint8_t plane_bit, bool wrap)
+{
     uint8_t vf = 0;//will become 1 if collection happen
+    size_t curr_y = y;
 
     for (int row = 0; row < sprite_height; row++) {//each iteration draw horizontal row of the sprite
         if (curr_y >= SCREEN_HEIGHT) {//stop if it go beyond screen bottom, this is no wrap behaviour
-            return vf;
+            if (!wrap)
+                return vf;
+            curr_y = 0;//wrap to the top row
         }
 
+        vm->dirty_rows |= 1u << curr_y;
         uint8_t byte = sprite[row];//read 1 sprite row (8 pixels)
         size_t curr_x = x;
         uint8_t mask = 0x80;   // 1000 0000, start with left most pixel
 
         for (int col = 0; col < 8; col++) {//inner pixel loop
             if (curr_x >= SCREEN_WIDTH) {//stop if go beyond screen right
-                break;
+                if (!wrap)
+                    break;
+                curr_x = 0;//wrap to the left column
             }
             /*
             byte = 10110010
@@ -51,7 +74,7 @@ uint8_t vmemory_draw_sprite_no_wrap(VMemory *vm, uint8_t x_pos, uint8_t y_pos, c
             mask = 01000000 ->new_pixel = 0
             mask = 00100000 ->new_pixel = 1
             */
-            uint8_t new_pixel = (byte & mask) >> (7 - col);//extract 1 pixcel from sprite byte
+            uint8_t new_pixel = (byte & mask) ? plane_bit : 0;//extract 1 pixcel from sprite byte, as this plane's bit
             /*
             old = 0 new = 0 res = 0^0=0
             old = 1 new = 0 res = 1
@@ -61,7 +84,7 @@ uint8_t vmemory_draw_sprite_no_wrap(VMemory *vm, uint8_t x_pos, uint8_t y_pos, c
             uint8_t old_pixel = vm->buffer[idx(curr_x, curr_y)];
             vm->buffer[idx(curr_x, curr_y)] = old_pixel ^ new_pixel;
             //collision happen when new_pixel =1 and old_pixel=1 CHIP8 turn off pixcel and set VF=1 (stay once set) 
-            vf |= (new_pixel & old_pixel);
+            vf |= (new_pixel & old_pixel) ? 1 : 0;
 
             mask >>= 1;
             curr_x++;//move right on screen
@@ -77,3 +100,47 @@ Result: # . . # . . # .
 */
     return vf;
 }
+
+static inline uint8_t draw_sprite(VMemory *vm, uint8_t x_pos, uint8_t y_pos, const uint8_t *sprite, int sprite_height, bool wrap)
+{
+    /*
+        sprite_height: sprint hight to draw
+        Each sprite is 8 pixel width, each sprite row = 1 byte = 8 pixcels
+        Use xor drawing and detect collisions(if any pixcel is turned off during drawing, set VF=1)
+        XO-CHIP: the sprite is drawn once per selected plane (lowest plane first), each plane
+        consumes the next sprite_height bytes
+        return VF (collision flag)
+    */
+    vm->draw_flag = true;
+
+    size_t x, y;
+    normalize_coordinates(x_pos, y_pos, &x, &y);//safe screen indices
+
+    uint8_t vf = 0;
+    for (uint8_t plane = 0; plane < PLANE_COUNT; plane++) {
+        uint8_t plane_bit = (uint8_t)(1u << plane);
+        if (!(vm->plane_mask & plane_bit))
+            continue;
+        vf |= draw_plane(vm, x, y, sprite, sprite_height, plane_bit, wrap);
+        sprite += sprite_height;//next plane data follows
+    }
+    return vf;
+}
+
+/// @brief 
+/// @param vm 
+/// @param x_pos : x cordinate (Vx)
+/// @param y_pos : y cordinate (Vy)
+/// @param sprite : pointer to sprite buffer, sprite_height rows for each selected plane
+/// @param sprite_height : number of rows
+/// @return : collision flag VF
+uint8_t vmemory_draw_sprite_no_wrap(VMemory *vm, uint8_t x_pos, uint8_t y_pos, const uint8_t *sprite, int sprite_height)
+{
+    return draw_sprite(vm, x_pos, y_pos, sprite, sprite_height, false);//clip at right and bottom edges
+}
+
+/// @brief Same as vmemory_draw_sprite_no_wrap, but pixels past an edge wrap to the opposite side
+uint8_t vmemory_draw_sprite_wrap(VMemory *vm, uint8_t x_pos, uint8_t y_pos, const uint8_t *sprite, int sprite_height)
+{
+    return draw_sprite(vm, x_pos, y_pos, sprite, sprite_height, true);
+}
@@ -2,19 +2,28 @@
 #define VMEMORY_H
 
 #include <stdint.h>
+#include <stddef.h>
 #include <stdbool.h>
 
 #define SCREEN_WIDTH 64
 #define SCREEN_HEIGHT 32
+#define PLANE_COUNT 4 //XO-CHIP bitplanes, pixel value is a bitmask of the planes that are ON
 
 typedef struct {
-    uint8_t buffer[SCREEN_WIDTH * SCREEN_HEIGHT];//screen buffer /video memory
+    uint8_t buffer[SCREEN_WIDTH * SCREEN_HEIGHT];//screen buffer /video memory, bit p set -> pixel ON in plane p
     bool draw_flag; //Tells emulator screen change- redraw on next frame
+    uint8_t plane_mask; //planes selected by Fn01, CHIP-8 programs only use plane 0 (mask 1)
+    uint32_t dirty_rows; //bit y set: row y was written since the last consumer (stream.c) cleared it
 } VMemory;
 
+#define ALL_ROWS 0xFFFFFFFFu //one bit per row, SCREEN_HEIGHT must stay <= 32
+
 void vmemory_init(VMemory *vm);
 void vmemory_clear(VMemory *vm);
+void vmemory_select_planes(VMemory *vm, uint8_t mask);
 uint8_t vmemory_draw_sprite_no_wrap(VMemory *vm, uint8_t x_pos, uint8_t y_pos, const uint8_t *sprite, int sprite_height);
+uint8_t vmemory_draw_sprite_wrap(VMemory *vm, uint8_t x_pos, uint8_t y_pos, const uint8_t *sprite, int sprite_height);
+uint64_t vmemory_hash(const VMemory *vm);
 
 // Helper functions
 static inline size_t idx(size_t x, size_t y) {
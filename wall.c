@@ -0,0 +1,128 @@
+#include "wall.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define GAP_COLOR 0xFF303030u
+
+int wall_init(Wall *w, uint32_t count, uint32_t scale, ColorTheme theme) {
+    memset(w, 0, sizeof(*w));
+    if (count == 0) return 1;
+
+    /* About 16:9 like the monitors: a tile is 2:1, so rows = cols * 9 / 8 */
+    uint32_t cols = 1;
+    while (cols * cols * 9 < count * 8)
+        cols++;
+    if (cols > count)
+        cols = count;
+    w->count = count;
+    w->cols = cols;
+    w->rows = (count + cols - 1) / cols;
+    w->width = cols * WALL_TILE_WIDTH + 1;
+    w->height = w->rows * WALL_TILE_HEIGHT + 1;
+
+    w->pixels = malloc((size_t)w->width * w->height * sizeof(uint32_t));
+    w->dirty = calloc(count, 1);
+    if (!w->pixels || !w->dirty) {
+        fprintf(stderr, "Wall: out of memory\n");
+        wall_shutdown(w);
+        return 1;
+    }
+    for (size_t i = 0; i < (size_t)w->width * w->height; i++)
+        w->pixels[i] = GAP_COLOR;
+    display_palette_from_theme(theme, w->palette);
+    for (uint32_t t = 0; t < count; t++) {//blank screens until the first frame
+        static const uint8_t blank[SCREEN_WIDTH * SCREEN_HEIGHT];
+        wall_update(w, t, blank);
+    }
+
+    if (SDL_InitSubSystem(SDL_INIT_VIDEO) != 0) {
+        fprintf(stderr, "SDL video init failed: %s\n", SDL_GetError());
+        wall_shutdown(w);
+        return 1;
+    }
+    if (scale * w->width > WALL_MAX_WIDTH)
+        scale = WALL_MAX_WIDTH / w->width;
+    if (scale == 0)
+        scale = 1;
+    char title[64];
+    snprintf(title, sizeof(title), "Chip8 wall: %u instances", (unsigned)count);
+    w->window = SDL_CreateWindow(title, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
+                                 (int)(w->width * scale), (int)(w->height * scale),
+                                 SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE);
+    if (!w->window) {
+        fprintf(stderr, "SDL_CreateWindow failed: %s\n", SDL_GetError());
+        wall_shutdown(w);
+        return 1;
+    }
+    w->renderer = SDL_CreateRenderer(w->window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+    if (!w->renderer) {
+        fprintf(stderr, "SDL_CreateRenderer failed: %s\n", SDL_GetError());
+        wall_shutdown(w);
+        return 1;
+    }
+    w->atlas = SDL_CreateTexture(w->renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING,
+                                 (int)w->width, (int)w->height);
+    if (!w->atlas) {
+        fprintf(stderr, "SDL_CreateTexture failed: %s\n", SDL_GetError());
+        wall_shutdown(w);
+        return 1;
+    }
+    /* The gaps never change, upload everything once */
+    SDL_UpdateTexture(w->atlas, NULL, w->pixels, (int)(w->width * sizeof(uint32_t)));
+    memset(w->dirty, 0, count);
+    w->any_dirty = true;//first present draws the wall
+    return 0;
+}
+
+void wall_update(Wall *w, uint32_t tile, const uint8_t *pixels) {
+    if (tile >= w->count) return;
+    uint32_t x = 1 + (tile % w->cols) * WALL_TILE_WIDTH;
+    uint32_t y = 1 + (tile / w->cols) * WALL_TILE_HEIGHT;
+    display_composite(pixels, w->pixels + (size_t)y * w->width + x, (int)(w->width * sizeof(uint32_t)), w->palette);
+    w->dirty[tile] = 1;
+    w->any_dirty = true;
+}
+
+int wall_present(Wall *w) {
+    if (!w->renderer) return 1;
+    if (!w->any_dirty) return 0;
+
+    /* One upload per row of tiles, from its first to its last changed tile */
+    for (uint32_t r = 0; r < w->rows; r++) {
+        uint32_t first = w->cols, last = 0;
+        for (uint32_t c = 0; c < w->cols; c++) {
+            uint32_t t = r * w->cols + c;
+            if (t >= w->count || !w->dirty[t]) continue;
+            w->dirty[t] = 0;
+            if (first == w->cols) first = c;
+            last = c;
+        }
+        if (first == w->cols) continue;
+        SDL_Rect rect = {
+            (int)(1 + first * WALL_TILE_WIDTH), (int)(1 + r * WALL_TILE_HEIGHT),
+            (int)((last - first + 1) * WALL_TILE_WIDTH - 1), SCREEN_HEIGHT
+        };
+        const uint32_t *src = w->pixels + (size_t)rect.y * w->width + rect.x;
+        if (SDL_UpdateTexture(w->atlas, &rect, src, (int)(w->width * sizeof(uint32_t))) != 0) {
+            fprintf(stderr, "SDL_UpdateTexture failed: %s\n", SDL_GetError());
+            return 1;
+        }
+    }
+    w->any_dirty = false;
+
+    SDL_RenderClear(w->renderer);
+    SDL_RenderCopy(w->renderer, w->atlas, NULL, NULL);//the whole wall, scaled to the window
+    SDL_RenderPresent(w->renderer);
+    return 0;
+}
+
+void wall_shutdown(Wall *w) {
+    if (!w) return;
+    if (w->atlas) SDL_DestroyTexture(w->atlas);
+    if (w->renderer) SDL_DestroyRenderer(w->renderer);
+    if (w->window) SDL_DestroyWindow(w->window);
+    free(w->pixels);
+    free(w->dirty);
+    memset(w, 0, sizeof(*w));
+}
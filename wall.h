@@ -0,0 +1,42 @@
+#ifndef WALL_H
+#define WALL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "SDL.h"
+#include "display.h"
+
+/* Atlas layout: tiles of 64x32 separated (and framed) by one gap pixel */
+#define WALL_TILE_WIDTH (SCREEN_WIDTH + 1)
+#define WALL_TILE_HEIGHT (SCREEN_HEIGHT + 1)
+#define WALL_MAX_WIDTH 1600 //window width the scale is capped to
+
+/*
+ * Wall view: many framebuffers in one window. Every instance is a tile of a single streaming texture
+ * (the atlas) and the whole wall is one SDL_RenderCopy. wall_update composites a changed framebuffer
+ * into the CPU copy of the atlas and marks its tile, wall_present uploads only the marked tiles
+ * (one SDL_UpdateTexture per row of tiles) before drawing.
+ */
+typedef struct {
+    SDL_Window *window;
+    SDL_Renderer *renderer;
+    SDL_Texture *atlas;
+    uint32_t count;//tiles
+    uint32_t cols, rows;
+    uint32_t width, height;//atlas in pixels
+    uint32_t *pixels;//CPU copy of the atlas, ARGB8888
+    uint8_t *dirty;//per tile: changed since the last present
+    bool any_dirty;
+    uint32_t palette[PALETTE_SIZE];
+} Wall;
+
+/* Opens the window, 'scale' is capped so the wall fits WALL_MAX_WIDTH. Returns 0 on success */
+int wall_init(Wall *w, uint32_t count, uint32_t scale, ColorTheme theme);
+/* 'pixels' is SCREEN_WIDTH * SCREEN_HEIGHT plane bitmasks, like DisplayHandler.draw_pixels */
+void wall_update(Wall *w, uint32_t tile, const uint8_t *pixels);
+/* Upload the changed tiles and show the wall. Returns 0 on success (also when nothing changed) */
+int wall_present(Wall *w);
+/* Safe to call even if init failed */
+void wall_shutdown(Wall *w);
+
+#endif /* WALL_H */